@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    MatchEQBenchmark.cpp
+
+    End-to-end timing of MatchEQAnalyzer: reading and averaging both files,
+    then the slope-pair fits. Open MatchEQBenchmark.jucer in the Projucer and
+    run it either with two files,
+
+        MatchEQBenchmark reference.wav target.wav
+
+    or with no arguments, in which case it writes a pair of 10 minute stereo
+    48 kHz WAVs to the temp folder: white noise as the target, and the same
+    noise through a known low cut, peak and high cut as the reference. The
+    fitted bands should land close to those.
+
+    MatchEQPipelineBenchmark.cpp runs the same pipeline without JUCE.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/MatchEQ.h"
+
+static constexpr double sampleRate = 48000.0;
+static constexpr int lengthInSeconds = 600;
+
+/*What the fit should recover from the generated files.*/
+static ChainSettings getKnownSettings()
+{
+    ChainSettings settings;
+    settings.lowCutFreq = 80.f;
+    settings.lowCutSlope = Slope_24;
+    settings.peakFreq = 2000.f;
+    settings.peakGainInDecibels = 4.f;
+    settings.peakQuality = 1.f;
+    settings.highCutFreq = 12000.f;
+    settings.highCutSlope = Slope_12;
+    return settings;
+}
+
+/*Writes the target and reference in blocks, so memory stays small for long files.*/
+static void generateFiles(const juce::File& reference, const juce::File& target)
+{
+    const auto settings = getKnownSettings();
+    const auto numChannels = 2, blockSize = 1 << 16;
+
+    auto lowCut = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(
+        settings.lowCutFreq, sampleRate, (settings.lowCutSlope + 1) * 2);
+    auto highCut = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
+        settings.highCutFreq, sampleRate, (settings.highCutSlope + 1) * 2);
+    auto peak = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
+        settings.peakFreq, settings.peakQuality, juce::Decibels::decibelsToGain(settings.peakGainInDecibels));
+
+    //One filter per stage per channel
+    juce::OwnedArray<juce::dsp::IIR::Filter<float>> filters[numChannels];
+
+    for (auto& channelFilters : filters)
+    {
+        for (auto& coefficients : lowCut)
+            channelFilters.add(new juce::dsp::IIR::Filter<float>(coefficients));
+
+        channelFilters.add(new juce::dsp::IIR::Filter<float>(peak));
+
+        for (auto& coefficients : highCut)
+            channelFilters.add(new juce::dsp::IIR::Filter<float>(coefficients));
+    }
+
+    juce::WavAudioFormat wav;
+    reference.deleteFile();
+    target.deleteFile();
+
+    std::unique_ptr<juce::AudioFormatWriter> referenceWriter(wav.createWriterFor(
+        new juce::FileOutputStream(reference), sampleRate, numChannels, 24, {}, 0));
+    std::unique_ptr<juce::AudioFormatWriter> targetWriter(wav.createWriterFor(
+        new juce::FileOutputStream(target), sampleRate, numChannels, 24, {}, 0));
+
+    juce::Random random(1234);
+    juce::AudioBuffer<float> block(numChannels, blockSize);
+    auto remaining = (juce::int64)(sampleRate * lengthInSeconds);
+
+    while (remaining > 0)
+    {
+        auto numSamples = (int)juce::jmin((juce::int64)blockSize, remaining);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                block.setSample(channel, i, 0.25f * (2.f * random.nextFloat() - 1.f));
+
+        targetWriter->writeFromAudioSampleBuffer(block, 0, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = block.getWritePointer(channel);
+
+            for (auto* filter : filters[channel])
+                for (int i = 0; i < numSamples; ++i)
+                    samples[i] = filter->processSample(samples[i]);
+        }
+
+        referenceWriter->writeFromAudioSampleBuffer(block, 0, numSamples);
+        remaining -= numSamples;
+    }
+}
+
+static void printSettings(const char* title, const ChainSettings& settings)
+{
+    std::printf("  %-8s low cut %7.1f Hz %d dB/oct, peak %7.1f Hz %+5.1f dB Q %4.2f, high cut %7.1f Hz %d dB/oct\n",
+        title,
+        settings.lowCutFreq, 12 * (settings.lowCutSlope + 1),
+        settings.peakFreq, settings.peakGainInDecibels, settings.peakQuality,
+        settings.highCutFreq, 12 * (settings.highCutSlope + 1));
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    //The analyzer reports back through the message thread
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::File reference, target;
+    auto generated = argc < 3;
+
+    if (generated)
+    {
+        auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory);
+        reference = folder.getChildFile("MatchEQBenchmark_reference.wav");
+        target = folder.getChildFile("MatchEQBenchmark_target.wav");
+
+        std::printf("Writing %d s test files to %s\n", lengthInSeconds, folder.getFullPathName().toRawUTF8());
+        generateFiles(reference, target);
+    }
+    else
+    {
+        reference = juce::File::getCurrentWorkingDirectory().getChildFile(argv[1]);
+        target = juce::File::getCurrentWorkingDirectory().getChildFile(argv[2]);
+    }
+
+    std::printf("Match EQ on %d CPUs\n", juce::SystemStats::getNumCpus());
+
+    //Same lifetime as in the plugin: one analyzer per analysis
+    auto analyzer = std::make_unique<MatchEQAnalyzer>();
+    auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+    analyzer->start(reference, target, sampleRate, [&](const juce::Result& result, const ChainSettings& settings)
+    {
+        std::printf("  end to end %.0f ms\n", juce::Time::getMillisecondCounterHiRes() - startMs);
+
+        if (result.failed())
+            std::printf("  failed: %s\n", result.getErrorMessage().toRawUTF8());
+        else
+            printSettings("fitted", settings);
+
+        if (generated)
+            printSettings("expected", getKnownSettings());
+
+        juce::MessageManager::getInstance()->stopDispatchLoop();
+    });
+
+    juce::MessageManager::getInstance()->runDispatchLoop();
+
+    analyzer.reset();
+
+    if (generated)
+    {
+        reference.deleteFile();
+        target.deleteFile();
+    }
+
+    return 0;
+}
@@ -0,0 +1,499 @@
+/*
+  ==============================================================================
+
+    MatchEQPipelineBenchmark.cpp
+
+    End-to-end timing of the Match EQ pipeline on a generated pair of
+    10 minute stereo 48 kHz 24-bit WAVs, and a check that the fit recovers
+    the bands the reference was filtered with. It needs no JUCE:
+
+        g++ -O2 -std=c++17 -pthread -I../Source MatchEQPipelineBenchmark.cpp -o MatchEQPipelineBenchmark
+
+    The band fit and the spectrum smoothing are Source/MatchEQFit.h, exactly
+    as the plugin runs them. Reading, downmixing, windowing and the FFT follow
+    MatchEQAnalyzer step for step (FFT 16384, hop 8192, unnormalised Hann, one
+    segment per thread per file, all queued at once), but with a plain WAV
+    reader and a radix-2 real FFT standing in for JUCE's. MatchEQBenchmark.jucer
+    times the real MatchEQAnalyzer. The output of the last run is committed
+    next to this file.
+
+  ==============================================================================
+*/
+
+#include "MatchEQFit.h"
+
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr double sampleRate = 48000.0;
+static constexpr int lengthInSeconds = 600;
+static constexpr int numChannels = 2;
+static constexpr double pi = 3.14159265358979323846;
+
+static constexpr int fftOrder = 14;
+static constexpr int fftSize = 1 << fftOrder;
+static constexpr int hopSize = fftSize / 2;
+
+/*Same fields as the plugin's ChainSettings; slopes are 0 (12 dB/oct) to 3 (48 dB/oct).*/
+struct Settings
+{
+    double lowCutFreq;
+    int lowCutSlope;
+    double peakFreq, peakGainInDecibels, peakQuality;
+    double highCutFreq;
+    int highCutSlope;
+};
+
+/*What the fit should recover from the generated files; same as MatchEQBenchmark.cpp.*/
+static const Settings knownSettings{ 80.0, 1, 2000.0, 4.0, 1.0, 12000.0, 0 };
+
+//==============================================================================
+/*Direct form II transposed biquad, as juce::dsp::IIR::Filter runs it.*/
+struct Biquad
+{
+    double b0, b1, b2, a1, a2;
+    double s1 = 0.0, s2 = 0.0;
+
+    float process(float input)
+    {
+        auto x = (double)input;
+        auto y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        return (float)y;
+    }
+};
+
+/*RBJ cookbook sections, which is what IIR::Coefficients builds.*/
+static Biquad makeCut(bool highPass, double frequency, double Q)
+{
+    auto w = 2.0 * pi * frequency / sampleRate;
+    auto alpha = std::sin(w) / (2.0 * Q), c = std::cos(w);
+    auto a0 = 1.0 + alpha;
+
+    if (highPass)
+        return { (1.0 + c) / 2.0 / a0, -(1.0 + c) / a0, (1.0 + c) / 2.0 / a0, -2.0 * c / a0, (1.0 - alpha) / a0 };
+
+    return { (1.0 - c) / 2.0 / a0, (1.0 - c) / a0, (1.0 - c) / 2.0 / a0, -2.0 * c / a0, (1.0 - alpha) / a0 };
+}
+
+static Biquad makePeak(double frequency, double Q, double gainInDecibels)
+{
+    auto A = std::pow(10.0, gainInDecibels / 40.0);
+    auto w = 2.0 * pi * frequency / sampleRate;
+    auto alpha = std::sin(w) / (2.0 * Q), c = std::cos(w);
+    auto a0 = 1.0 + alpha / A;
+
+    return { (1.0 + alpha * A) / a0, -2.0 * c / a0, (1.0 - alpha * A) / a0, -2.0 * c / a0, (1.0 - alpha / A) / a0 };
+}
+
+/*Order (slope + 1) * 2 Butterworth as second-order sections, like FilterDesign's HighOrderButterworthMethod.*/
+static void addButterworth(std::vector<Biquad>& filters, bool highPass, double frequency, int slope)
+{
+    auto order = (slope + 1) * 2;
+
+    for (int k = 0; k < order / 2; ++k)
+        filters.push_back(makeCut(highPass, frequency, 1.0 / (2.0 * std::sin((2 * k + 1) * pi / (2.0 * order)))));
+}
+
+//==============================================================================
+static void writeHeader(std::FILE* file, int64_t numFrames)
+{
+    auto dataBytes = (uint32_t)(numFrames * numChannels * 3);
+    auto put32 = [file](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto put16 = [file](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+
+    std::fwrite("RIFF", 1, 4, file);
+    put32(36 + dataBytes);
+    std::fwrite("WAVEfmt ", 1, 8, file);
+    put32(16);
+    put16(1);
+    put16(numChannels);
+    put32((uint32_t)sampleRate);
+    put32((uint32_t)sampleRate * numChannels * 3);
+    put16(numChannels * 3);
+    put16(24);
+    std::fwrite("data", 1, 4, file);
+    put32(dataBytes);
+}
+
+static void putSample24(std::vector<unsigned char>& bytes, float sample)
+{
+    auto value = (int32_t)std::lround(std::clamp(sample, -1.f, 1.f) * 8388607.f);
+    bytes.push_back((unsigned char)(value & 0xff));
+    bytes.push_back((unsigned char)((value >> 8) & 0xff));
+    bytes.push_back((unsigned char)((value >> 16) & 0xff));
+}
+
+/*White noise as the target, and the same noise through the known bands as the reference.*/
+static void generateFiles(const std::string& reference, const std::string& target)
+{
+    std::vector<Biquad> filters[numChannels];
+
+    for (auto& channelFilters : filters)
+    {
+        addButterworth(channelFilters, true, knownSettings.lowCutFreq, knownSettings.lowCutSlope);
+        channelFilters.push_back(makePeak(knownSettings.peakFreq, knownSettings.peakQuality, knownSettings.peakGainInDecibels));
+        addButterworth(channelFilters, false, knownSettings.highCutFreq, knownSettings.highCutSlope);
+    }
+
+    const auto numFrames = (int64_t)(sampleRate * lengthInSeconds);
+    auto* referenceFile = std::fopen(reference.c_str(), "wb");
+    auto* targetFile = std::fopen(target.c_str(), "wb");
+    writeHeader(referenceFile, numFrames);
+    writeHeader(targetFile, numFrames);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> noise(-0.25f, 0.25f);
+    std::vector<unsigned char> referenceBytes, targetBytes;
+
+    for (int64_t start = 0; start < numFrames; start += 1 << 16)
+    {
+        auto numSamples = std::min((int64_t)1 << 16, numFrames - start);
+        referenceBytes.clear();
+        targetBytes.clear();
+
+        for (int64_t i = 0; i < numSamples; ++i)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto sample = noise(random);
+                putSample24(targetBytes, sample);
+
+                for (auto& filter : filters[channel])
+                    sample = filter.process(sample);
+
+                putSample24(referenceBytes, sample);
+            }
+        }
+
+        std::fwrite(targetBytes.data(), 1, targetBytes.size(), targetFile);
+        std::fwrite(referenceBytes.data(), 1, referenceBytes.size(), referenceFile);
+    }
+
+    std::fclose(referenceFile);
+    std::fclose(targetFile);
+}
+
+//==============================================================================
+/*Only reads what generateFiles() writes: 16-byte fmt chunk, 24-bit PCM.*/
+struct WavReader
+{
+    explicit WavReader(const std::string& path)
+    {
+        file = std::fopen(path.c_str(), "rb");
+
+        if (file == nullptr)
+            return;
+
+        unsigned char header[44];
+
+        if (std::fread(header, 1, 44, file) != 44 || std::memcmp(header + 36, "data", 4) != 0)
+            return;
+
+        uint32_t dataBytes;
+        std::memcpy(&dataBytes, header + 40, 4);
+        numChannelsInFile = header[22];
+        lengthInSamples = dataBytes / (3 * numChannelsInFile);
+    }
+
+    ~WavReader() { if (file != nullptr) std::fclose(file); }
+
+    /*Downmixed to mono, zero-padded past the end, like MatchEQAnalyzer's readHop.*/
+    void readMono(int64_t position, float* destination, int numSamples)
+    {
+        bytes.resize((size_t)numSamples * 3 * (size_t)numChannelsInFile);
+        auto available = (int)std::max((int64_t)0, std::min((int64_t)numSamples, lengthInSamples - position));
+
+        std::fseek(file, (long)(44 + position * 3 * numChannelsInFile), SEEK_SET);
+        auto numRead = (int)(std::fread(bytes.data(), (size_t)3 * (size_t)numChannelsInFile, (size_t)available, file));
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float sum = 0.f;
+
+            if (i < numRead)
+            {
+                for (int channel = 0; channel < numChannelsInFile; ++channel)
+                {
+                    auto* b = bytes.data() + 3 * ((size_t)i * (size_t)numChannelsInFile + (size_t)channel);
+                    auto value = (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24) >> 8;
+                    sum += (float)value / 8388608.f;
+                }
+            }
+
+            destination[i] = sum / (float)numChannelsInFile;
+        }
+    }
+
+    std::FILE* file = nullptr;
+    int numChannelsInFile = 0;
+    int64_t lengthInSamples = 0;
+    std::vector<unsigned char> bytes;
+};
+
+//==============================================================================
+/*
+Real-input FFT: the fftSize real samples are packed into fftSize / 2 complex
+values, transformed, then split into the positive-frequency bins.
+*/
+struct FFT
+{
+    static constexpr int halfSize = fftSize / 2;
+
+    FFT()
+    {
+        for (int i = 0; i < halfSize; ++i)
+        {
+            twiddles.push_back(std::polar(1.f, (float)(-2.0 * pi * i / halfSize)));
+            splitTwiddles.push_back(std::polar(1.f, (float)(-2.0 * pi * i / fftSize)));
+        }
+    }
+
+    static std::complex<float> multiply(std::complex<float> a, std::complex<float> b)
+    {
+        return { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+    }
+
+    void performComplex(std::complex<float>* data) const
+    {
+        const auto n = (size_t)halfSize;
+
+        for (size_t i = 1, j = 0; i < n; ++i)
+        {
+            auto bit = n >> 1;
+
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+
+            j ^= bit;
+
+            if (i < j)
+                std::swap(data[i], data[j]);
+        }
+
+        for (size_t length = 2; length <= n; length <<= 1)
+        {
+            auto stride = n / length;
+
+            for (size_t start = 0; start < n; start += length)
+            {
+                for (size_t k = 0; k < length / 2; ++k)
+                {
+                    auto even = data[start + k], odd = multiply(data[start + k + length / 2], twiddles[k * stride]);
+                    data[start + k] = even + odd;
+                    data[start + k + length / 2] = even - odd;
+                }
+            }
+        }
+    }
+
+    /*Adds |X[k]|^2 for k = 0 ... fftSize / 2 to power.*/
+    void accumulatePower(const float* input, std::vector<std::complex<float>>& scratch, std::vector<double>& power) const
+    {
+        for (size_t i = 0; i < (size_t)halfSize; ++i)
+            scratch[i] = { input[2 * i], input[2 * i + 1] };
+
+        performComplex(scratch.data());
+
+        power[0] += (double)((scratch[0].real() + scratch[0].imag()) * (scratch[0].real() + scratch[0].imag()));
+        power[(size_t)halfSize] += (double)((scratch[0].real() - scratch[0].imag()) * (scratch[0].real() - scratch[0].imag()));
+
+        for (size_t k = 1; k < (size_t)halfSize; ++k)
+        {
+            auto z = scratch[k], mirrored = std::conj(scratch[(size_t)halfSize - k]);
+            auto even = 0.5f * (z + mirrored);
+            auto odd = multiply(std::complex<float>(0.f, -0.5f) * (z - mirrored), splitTwiddles[k]);
+            auto bin = even + odd;
+            power[k] += (double)(bin.real() * bin.real() + bin.imag() * bin.imag());
+        }
+    }
+
+    std::vector<std::complex<float>> twiddles, splitTwiddles;
+};
+
+/*Same sliding frame as MatchEQAnalyzer::accumulateSegment.*/
+static void accumulateSegment(const std::string& path, int64_t firstFrame, int64_t endFrame,
+                              std::vector<double>& power)
+{
+    power.assign(fftSize / 2 + 1, 0.0);
+
+    WavReader reader(path);
+    FFT fft;
+
+    //juce::dsp::WindowingFunction's unnormalised Hann
+    std::vector<float> window((size_t)fftSize);
+
+    for (int i = 0; i < fftSize; ++i)
+        window[(size_t)i] = (float)(0.5 - 0.5 * std::cos(2.0 * pi * i / (fftSize - 1)));
+
+    std::vector<float> frame((size_t)fftSize);
+    std::vector<float> windowed((size_t)fftSize);
+    std::vector<std::complex<float>> scratch((size_t)FFT::halfSize);
+
+    auto position = firstFrame * hopSize;
+    reader.readMono(position, frame.data(), hopSize);
+    reader.readMono(position + hopSize, frame.data() + hopSize, hopSize);
+
+    for (auto index = firstFrame; index < endFrame; ++index)
+    {
+        for (size_t i = 0; i < (size_t)fftSize; ++i)
+            windowed[i] = frame[i] * window[i];
+
+        fft.accumulatePower(windowed.data(), scratch, power);
+
+        std::copy(frame.begin() + hopSize, frame.end(), frame.begin());
+        position += hopSize;
+        reader.readMono(position + hopSize, frame.data() + hopSize, hopSize);
+    }
+}
+
+/*Runs job(0) ... job(numJobs - 1) on numThreads threads, like MatchEQAnalyzer::runOnPool.*/
+template <typename Job>
+static void runOnThreads(int numThreads, int numJobs, const Job& job)
+{
+    std::atomic<int> next{ 0 };
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < numThreads; ++t)
+        threads.emplace_back([&]
+        {
+            for (int i = next++; i < numJobs; i = next++)
+                job(i);
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+//==============================================================================
+static Settings matchEQ(const std::string& reference, const std::string& target, int numThreads,
+                        double& fitMilliseconds)
+{
+    struct Segment
+    {
+        const std::string* path;
+        int fileIndex;
+        int64_t firstFrame, endFrame;
+        std::vector<double> power;
+    };
+
+    std::vector<Segment> segments;
+    const std::string* paths[] = { &reference, &target };
+    int64_t numFrames[2];
+
+    for (int fileIndex = 0; fileIndex < 2; ++fileIndex)
+    {
+        WavReader reader(*paths[fileIndex]);
+        numFrames[fileIndex] = std::max((int64_t)1, (reader.lengthInSamples - fftSize) / hopSize + 1);
+        auto numSegments = std::min((int64_t)numThreads, numFrames[fileIndex]);
+
+        for (int64_t i = 0; i < numSegments; ++i)
+            segments.push_back({ paths[fileIndex], fileIndex,
+                                 numFrames[fileIndex] * i / numSegments,
+                                 numFrames[fileIndex] * (i + 1) / numSegments,
+                                 {} });
+    }
+
+    runOnThreads(numThreads, (int)segments.size(), [&segments](int index)
+    {
+        auto& segment = segments[(size_t)index];
+        accumulateSegment(*segment.path, segment.firstFrame, segment.endFrame, segment.power);
+    });
+
+    std::vector<double> power[2] = { std::vector<double>(fftSize / 2 + 1, 0.0), std::vector<double>(fftSize / 2 + 1, 0.0) };
+
+    for (auto& segment : segments)
+        for (size_t bin = 0; bin < segment.power.size(); ++bin)
+            power[segment.fileIndex][bin] += segment.power[bin];
+
+    for (int fileIndex = 0; fileIndex < 2; ++fileIndex)
+        for (auto& bin : power[fileIndex])
+            bin /= (double)numFrames[fileIndex];
+
+    auto fitStart = std::chrono::steady_clock::now();
+    auto points = MatchEQFit::makePoints(MatchEQFit::smoothToGrid(power[0], sampleRate, fftSize),
+                                         MatchEQFit::smoothToGrid(power[1], sampleRate, fftSize));
+
+    double start[Fit_NumParameters];
+    MatchEQFit::initialGuess(points, start);
+
+    constexpr int numSlopes = MatchEQFit::numSlopes;
+    double fits[numSlopes * numSlopes][Fit_NumParameters], costs[numSlopes * numSlopes];
+
+    runOnThreads(numThreads, numSlopes * numSlopes, [&](int index)
+    {
+        std::copy(start, start + Fit_NumParameters, fits[index]);
+        costs[index] = MatchEQFit::fitBands(fits[index], index / numSlopes, index % numSlopes, points, sampleRate);
+    });
+
+    fitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fitStart).count();
+
+    auto best = (int)(std::min_element(costs, costs + numSlopes * numSlopes) - costs);
+    auto& p = fits[best];
+
+    return { std::exp(p[Fit_LogLowCutFreq]), best / numSlopes,
+             std::exp(p[Fit_LogPeakFreq]), p[Fit_PeakGain], std::exp(p[Fit_LogPeakQ]),
+             std::exp(p[Fit_LogHighCutFreq]), best % numSlopes };
+}
+
+static void printSettings(const char* title, const Settings& settings)
+{
+    std::printf("  %-8s low cut %7.1f Hz %d dB/oct, peak %7.1f Hz %+5.1f dB Q %4.2f, high cut %7.1f Hz %d dB/oct\n",
+        title,
+        settings.lowCutFreq, 12 * (settings.lowCutSlope + 1),
+        settings.peakFreq, settings.peakGainInDecibels, settings.peakQuality,
+        settings.highCutFreq, 12 * (settings.highCutSlope + 1));
+}
+
+/*Within a tenth of an octave, 0.5 dB and the right slopes counts as recovered.*/
+static bool recovered(const Settings& fitted, const Settings& expected)
+{
+    auto octaves = [](double a, double b) { return std::abs(std::log2(a / b)); };
+
+    return octaves(fitted.lowCutFreq, expected.lowCutFreq) < 0.1
+        && octaves(fitted.highCutFreq, expected.highCutFreq) < 0.1
+        && octaves(fitted.peakFreq, expected.peakFreq) < 0.1
+        && std::abs(fitted.peakGainInDecibels - expected.peakGainInDecibels) < 0.5
+        && fitted.lowCutSlope == expected.lowCutSlope
+        && fitted.highCutSlope == expected.highCutSlope;
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    std::string folder = argc > 1 ? argv[1] : "/tmp";
+    auto reference = folder + "/MatchEQPipelineBenchmark_reference.wav";
+    auto target = folder + "/MatchEQPipelineBenchmark_target.wav";
+
+    std::printf("Writing %d s stereo 48 kHz 24-bit test files to %s\n", lengthInSeconds, folder.c_str());
+    generateFiles(reference, target);
+
+    auto numThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::printf("Match EQ on %d CPUs\n", numThreads);
+
+    for (int run = 0; run < 3; ++run)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        double fitMilliseconds = 0.0;
+        auto fitted = matchEQ(reference, target, numThreads, fitMilliseconds);
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        std::printf("Run %d: end to end %.0f ms, of which the 16 slope fits %.0f ms\n", run + 1, ms, fitMilliseconds);
+        printSettings("fitted", fitted);
+        printSettings("expected", knownSettings);
+        std::printf("  recovered: %s\n", recovered(fitted, knownSettings) ? "yes" : "no");
+    }
+
+    std::remove(reference.c_str());
+    std::remove(target.c_str());
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    SaturationBenchmark.cpp
+
+    Aliasing, CPU and latency of every saturation mode as the plugin runs it:
+    each measurement drives the plugin's own TubeSaturator, so "Oversampled 4x"
+    is the real juce::dsp::Oversampling polyphase IIR path and the latency is
+    the one reported to the host. Open SaturationBenchmark.jucer in the
+    Projucer and run the console app; keep its output next to this file as
+    SaturationBenchmark_output.txt.
+
+    ADAABenchmark.cpp measures the ADAA kernels on their own without JUCE.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/Saturation.h"
+
+static constexpr double sampleRate = 48000.0;
+static constexpr int blockSize = 512;
+
+struct ModeToMeasure
+{
+    SaturationMode mode;
+    const char* name;
+};
+
+static const ModeToMeasure modes[] =
+{
+    { Saturation_Off,         "1x naive (no AA)" },   //the bare curve, measured below rather than by the plugin
+    { Saturation_ADAA1,       "ADAA 1st order" },
+    { Saturation_ADAA2,       "ADAA 2nd order" },
+    { Saturation_Oversampled, "Oversampled 4x" }
+};
+
+/*Same gain staging as TubeSaturator: drive, bias, remove DC, undo drive.*/
+static float shapeWithoutAntialiasing(float x, double drive)
+{
+    auto offset = SoftClipCurve::curve(SoftClipCurve::bias);
+    return (float)((SoftClipCurve::curve(drive * x + SoftClipCurve::bias) - offset) / drive);
+}
+
+/*Runs the whole buffer through the saturator in plugin-sized blocks, or through the bare curve for Saturation_Off.*/
+static void process(TubeSaturator& saturator, SaturationMode mode, float driveInDecibels, juce::AudioBuffer<float>& buffer)
+{
+    if (mode == Saturation_Off)
+    {
+        auto drive = (double)juce::Decibels::decibelsToGain(driveInDecibels);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                samples[i] = shapeWithoutAntialiasing(samples[i], drive);
+        }
+
+        return;
+    }
+
+    juce::dsp::AudioBlock<float> wholeBuffer(buffer);
+
+    for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+    {
+        auto numSamples = juce::jmin(blockSize, buffer.getNumSamples() - start);
+        auto block = wholeBuffer.getSubBlock((size_t)start, (size_t)numSamples);
+
+        saturator.setParameters(mode, driveInDecibels, numSamples);
+        saturator.process(block, 0, buffer.getNumChannels());
+    }
+}
+
+//==============================================================================
+struct AliasingResult
+{
+    double aliasingInDecibels;     //energy off the harmonic bins, relative to the harmonics
+    double fundamentalPower;       //to compare against the bare curve (ADAA's high-frequency droop)
+};
+
+/*
+Sine at an exact bin centre, so every true harmonic below Nyquist lands on a
+known bin. Whatever is left after removing those bins (and DC) is aliasing.
+The settling time also covers the oversampler's latency.
+*/
+static AliasingResult measureAliasing(SaturationMode mode, double frequency, float driveInDecibels)
+{
+    const int fftOrder = 16, numBins = 1 << fftOrder;
+    const int settle = 8192;
+    const int fundamentalBin = juce::roundToInt(frequency * numBins / sampleRate);
+    const double exactFrequency = fundamentalBin * sampleRate / numBins;
+
+    juce::AudioBuffer<float> signal(1, numBins + settle);
+
+    for (int i = 0; i < signal.getNumSamples(); ++i)
+        signal.setSample(0, i, (float)std::sin(juce::MathConstants<double>::twoPi * exactFrequency * i / sampleRate));
+
+    TubeSaturator saturator;
+    saturator.prepare(sampleRate, blockSize, 1);
+    process(saturator, mode, driveInDecibels, signal);
+
+    //4-term Blackman-Harris: sidelobes under -92 dB, main lobe +-4 bins
+    std::vector<float> fftData(2 * (size_t)numBins, 0.f);
+
+    for (int i = 0; i < numBins; ++i)
+    {
+        auto phase = juce::MathConstants<double>::twoPi * i / numBins;
+        auto window = 0.35875 - 0.48829 * std::cos(phase) + 0.14128 * std::cos(2.0 * phase) - 0.01168 * std::cos(3.0 * phase);
+        fftData[(size_t)i] = (float)(signal.getSample(0, settle + i) * window);
+    }
+
+    juce::dsp::FFT fft(fftOrder);
+    fft.performRealOnlyForwardTransform(fftData.data(), true);
+
+    auto power = [&fftData](int bin)
+    {
+        auto re = (double)fftData[2 * (size_t)bin], im = (double)fftData[2 * (size_t)bin + 1];
+        return re * re + im * im;
+    };
+
+    std::vector<bool> harmonic((size_t)numBins / 2, false);
+
+    for (int h = 0; h < numBins / 2; h += fundamentalBin)
+        for (int b = juce::jmax(0, h - 6); b <= juce::jmin(numBins / 2 - 1, h + 6); ++b)
+            harmonic[(size_t)b] = true;
+
+    double harmonicEnergy = 0.0, aliasEnergy = 0.0, fundamental = 0.0;
+
+    //Skip DC (h == 0 above) and the bins next to Nyquist
+    for (int b = 7; b < numBins / 2 - 8; ++b)
+        (harmonic[(size_t)b] ? harmonicEnergy : aliasEnergy) += power(b);
+
+    for (int b = fundamentalBin - 6; b <= fundamentalBin + 6; ++b)
+        fundamental += power(b);
+
+    return { 10.0 * std::log10(aliasEnergy / harmonicEnergy), fundamental };
+}
+
+//==============================================================================
+/*Nanoseconds per sample per channel, numChannels in one saturator, 512-sample blocks.*/
+static double measureSpeed(SaturationMode mode, int numChannels)
+{
+    const int numBlocks = 2000;
+
+    TubeSaturator saturator;
+    saturator.prepare(sampleRate, blockSize, numChannels);
+
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::int64 totalTicks = 0;
+
+    for (int blockIndex = 0; blockIndex < numBlocks; ++blockIndex)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < blockSize; ++i)
+                buffer.setSample(channel, i, 0.9f * (float)std::sin(0.05 * (channel + 1) * (blockIndex * blockSize + i)));
+
+        auto start = juce::Time::getHighResolutionTicks();
+        process(saturator, mode, 12.f, buffer);
+        totalTicks += juce::Time::getHighResolutionTicks() - start;
+    }
+
+    return 1.0e9 * juce::Time::highResolutionTicksToSeconds(totalTicks) / ((double)numBlocks * blockSize * numChannels);
+}
+
+//==============================================================================
+int main()
+{
+    std::printf("Saturation benchmark (TubeSaturator), %.0f Hz, full-scale sine\n", sampleRate);
+    std::printf("Aliasing: energy outside the true harmonic bins, relative to the harmonics (lower is better)\n");
+    std::printf("Fundamental: level of the fundamental relative to the bare curve (ADAA's high-frequency droop)\n\n");
+
+    const double frequencies[] = { 1000.0, 5000.0, 10000.0 };
+    const float drives[] = { 0.f, 6.f, 12.f, 18.f };
+
+    for (auto frequency : frequencies)
+    {
+        std::printf("Sine %.0f Hz\n", frequency);
+        std::printf("  %-20s", "drive");
+
+        for (auto drive : drives)
+            std::printf("  %6.0f dB          ", drive);
+
+        std::printf("\n");
+
+        for (auto& mode : modes)
+        {
+            std::printf("  %-20s", mode.name);
+
+            for (auto drive : drives)
+            {
+                auto bare = measureAliasing(Saturation_Off, frequency, drive);
+                auto result = measureAliasing(mode.mode, frequency, drive);
+
+                std::printf("  %7.1f dB (%+5.2f)", result.aliasingInDecibels,
+                            10.0 * std::log10(result.fundamentalPower / bare.fundamentalPower));
+            }
+
+            std::printf("\n");
+        }
+
+        std::printf("\n");
+    }
+
+    std::printf("CPU: ns per sample per channel, drive 12 dB, 512-sample blocks\n");
+    std::printf("  %-20s%10s%10s%10s%10s\n", "", "1 ch", "2 ch", "4 ch", "8 ch");
+
+    for (auto& mode : modes)
+    {
+        std::printf("  %-20s", mode.name);
+
+        for (auto numChannels : { 1, 2, 4, 8 })
+            std::printf("%10.2f", measureSpeed(mode.mode, numChannels));
+
+        std::printf("\n");
+    }
+
+    TubeSaturator saturator;
+    saturator.prepare(sampleRate, blockSize, 1);
+
+    std::printf("\nLatency reported to the host: ADAA 1st order %d, ADAA 2nd order %d, Oversampled 4x %d samples\n",
+                saturator.getLatencyInSamples(Saturation_ADAA1),
+                saturator.getLatencyInSamples(Saturation_ADAA2),
+                saturator.getLatencyInSamples(Saturation_Oversampled));
+
+    return 0;
+}
@@ -0,0 +1,386 @@
+/*
+  ==============================================================================
+
+    ADAAKernels.h
+
+    The saturation curve and its antiderivative anti-aliased (ADAA) kernels.
+    Deliberately free of JUCE so Benchmarks/ADAABenchmark.cpp can build the
+    exact code the plugin runs without the rest of the project.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define SIMPLEEQ_ADAA_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+ #include <arm_neon.h>
+ #define SIMPLEEQ_ADAA_NEON 1
+#endif
+
+/*
+One SIMD register of doubles, with only the operations the kernels need.
+AVX holds four channels, SSE2 and NEON two; anything else falls back to one.
+Comparisons give a Mask, and select() replaces branches.
+*/
+struct ADAAVector
+{
+   #if defined(__AVX__)
+    using Native = __m256d;
+    using Mask = __m256d;
+    static constexpr int size = 4;
+
+    ADAAVector(double v) noexcept : value(_mm256_set1_pd(v)) {}
+    ADAAVector(Native v) noexcept : value(v) {}
+    static ADAAVector load(const double* source) noexcept { return _mm256_loadu_pd(source); }
+    void store(double* destination) const noexcept { _mm256_storeu_pd(destination, value); }
+
+    friend ADAAVector operator+ (ADAAVector a, ADAAVector b) noexcept { return _mm256_add_pd(a.value, b.value); }
+    friend ADAAVector operator- (ADAAVector a, ADAAVector b) noexcept { return _mm256_sub_pd(a.value, b.value); }
+    friend ADAAVector operator* (ADAAVector a, ADAAVector b) noexcept { return _mm256_mul_pd(a.value, b.value); }
+    friend ADAAVector operator/ (ADAAVector a, ADAAVector b) noexcept { return _mm256_div_pd(a.value, b.value); }
+
+    friend ADAAVector adaaMin(ADAAVector a, ADAAVector b) noexcept { return _mm256_min_pd(a.value, b.value); }
+    friend ADAAVector adaaMax(ADAAVector a, ADAAVector b) noexcept { return _mm256_max_pd(a.value, b.value); }
+    friend ADAAVector adaaAbs(ADAAVector a) noexcept { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.value); }
+
+    friend ADAAVector adaaCopySign(ADAAVector magnitude, ADAAVector sign) noexcept
+    {
+        auto signBit = _mm256_set1_pd(-0.0);
+        return _mm256_or_pd(_mm256_andnot_pd(signBit, magnitude.value), _mm256_and_pd(signBit, sign.value));
+    }
+
+    friend Mask lessThan(ADAAVector a, ADAAVector b) noexcept { return _mm256_cmp_pd(a.value, b.value, _CMP_LT_OQ); }
+    friend ADAAVector select(Mask mask, ADAAVector ifTrue, ADAAVector ifFalse) noexcept
+    {
+        return _mm256_blendv_pd(ifFalse.value, ifTrue.value, mask);
+    }
+   #elif SIMPLEEQ_ADAA_SSE2
+    using Native = __m128d;
+    using Mask = __m128d;
+    static constexpr int size = 2;
+
+    ADAAVector(double v) noexcept : value(_mm_set1_pd(v)) {}
+    ADAAVector(Native v) noexcept : value(v) {}
+    static ADAAVector load(const double* source) noexcept { return _mm_loadu_pd(source); }
+    void store(double* destination) const noexcept { _mm_storeu_pd(destination, value); }
+
+    friend ADAAVector operator+ (ADAAVector a, ADAAVector b) noexcept { return _mm_add_pd(a.value, b.value); }
+    friend ADAAVector operator- (ADAAVector a, ADAAVector b) noexcept { return _mm_sub_pd(a.value, b.value); }
+    friend ADAAVector operator* (ADAAVector a, ADAAVector b) noexcept { return _mm_mul_pd(a.value, b.value); }
+    friend ADAAVector operator/ (ADAAVector a, ADAAVector b) noexcept { return _mm_div_pd(a.value, b.value); }
+
+    friend ADAAVector adaaMin(ADAAVector a, ADAAVector b) noexcept { return _mm_min_pd(a.value, b.value); }
+    friend ADAAVector adaaMax(ADAAVector a, ADAAVector b) noexcept { return _mm_max_pd(a.value, b.value); }
+    friend ADAAVector adaaAbs(ADAAVector a) noexcept { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.value); }
+
+    friend ADAAVector adaaCopySign(ADAAVector magnitude, ADAAVector sign) noexcept
+    {
+        auto signBit = _mm_set1_pd(-0.0);
+        return _mm_or_pd(_mm_andnot_pd(signBit, magnitude.value), _mm_and_pd(signBit, sign.value));
+    }
+
+    friend Mask lessThan(ADAAVector a, ADAAVector b) noexcept { return _mm_cmplt_pd(a.value, b.value); }
+    friend ADAAVector select(Mask mask, ADAAVector ifTrue, ADAAVector ifFalse) noexcept
+    {
+        return _mm_or_pd(_mm_and_pd(mask, ifTrue.value), _mm_andnot_pd(mask, ifFalse.value));
+    }
+   #elif SIMPLEEQ_ADAA_NEON
+    using Native = float64x2_t;
+    using Mask = uint64x2_t;
+    static constexpr int size = 2;
+
+    ADAAVector(double v) noexcept : value(vdupq_n_f64(v)) {}
+    ADAAVector(Native v) noexcept : value(v) {}
+    static ADAAVector load(const double* source) noexcept { return vld1q_f64(source); }
+    void store(double* destination) const noexcept { vst1q_f64(destination, value); }
+
+    friend ADAAVector operator+ (ADAAVector a, ADAAVector b) noexcept { return vaddq_f64(a.value, b.value); }
+    friend ADAAVector operator- (ADAAVector a, ADAAVector b) noexcept { return vsubq_f64(a.value, b.value); }
+    friend ADAAVector operator* (ADAAVector a, ADAAVector b) noexcept { return vmulq_f64(a.value, b.value); }
+    friend ADAAVector operator/ (ADAAVector a, ADAAVector b) noexcept { return vdivq_f64(a.value, b.value); }
+
+    friend ADAAVector adaaMin(ADAAVector a, ADAAVector b) noexcept { return vminq_f64(a.value, b.value); }
+    friend ADAAVector adaaMax(ADAAVector a, ADAAVector b) noexcept { return vmaxq_f64(a.value, b.value); }
+    friend ADAAVector adaaAbs(ADAAVector a) noexcept { return vabsq_f64(a.value); }
+
+    friend ADAAVector adaaCopySign(ADAAVector magnitude, ADAAVector sign) noexcept
+    {
+        return vbslq_f64(vdupq_n_u64(0x8000000000000000ull), sign.value, magnitude.value);
+    }
+
+    friend Mask lessThan(ADAAVector a, ADAAVector b) noexcept { return vcltq_f64(a.value, b.value); }
+    friend ADAAVector select(Mask mask, ADAAVector ifTrue, ADAAVector ifFalse) noexcept
+    {
+        return vbslq_f64(mask, ifTrue.value, ifFalse.value);
+    }
+   #else
+    using Native = double;
+    using Mask = bool;
+    static constexpr int size = 1;
+
+    ADAAVector(double v) noexcept : value(v) {}
+    static ADAAVector load(const double* source) noexcept { return *source; }
+    void store(double* destination) const noexcept { *destination = value; }
+
+    friend ADAAVector operator+ (ADAAVector a, ADAAVector b) noexcept { return a.value + b.value; }
+    friend ADAAVector operator- (ADAAVector a, ADAAVector b) noexcept { return a.value - b.value; }
+    friend ADAAVector operator* (ADAAVector a, ADAAVector b) noexcept { return a.value * b.value; }
+    friend ADAAVector operator/ (ADAAVector a, ADAAVector b) noexcept { return a.value / b.value; }
+
+    friend ADAAVector adaaMin(ADAAVector a, ADAAVector b) noexcept { return std::min(a.value, b.value); }
+    friend ADAAVector adaaMax(ADAAVector a, ADAAVector b) noexcept { return std::max(a.value, b.value); }
+    friend ADAAVector adaaAbs(ADAAVector a) noexcept { return std::abs(a.value); }
+    friend ADAAVector adaaCopySign(ADAAVector magnitude, ADAAVector sign) noexcept { return std::copysign(magnitude.value, sign.value); }
+
+    friend Mask lessThan(ADAAVector a, ADAAVector b) noexcept { return a.value < b.value; }
+    friend ADAAVector select(Mask mask, ADAAVector ifTrue, ADAAVector ifFalse) noexcept { return mask ? ifTrue : ifFalse; }
+   #endif
+
+    Native value;
+};
+
+//Scalar versions, so the curve can be written once for doubles and vectors
+inline double adaaMin(double a, double b) noexcept { return std::min(a, b); }
+inline double adaaMax(double a, double b) noexcept { return std::max(a, b); }
+inline double adaaAbs(double a) noexcept { return std::abs(a); }
+inline double adaaCopySign(double magnitude, double sign) noexcept { return std::copysign(magnitude, sign); }
+
+/*
+Asymmetric cubic soft clipper: f(u) = u - u^3/3, clipped to +-2/3 outside
+|u| <= 1, evaluated at the driven input plus a bias. Both antiderivatives have
+closed forms, which is what makes ADAA cheap here. They are written with
+min/max/copysign rather than branches, so the same code runs on one double
+or on a whole ADAAVector, and multiply by reciprocals because the compiler
+won't turn a division by 3 into one by itself.
+*/
+struct SoftClipCurve
+{
+    /*Shifts the operating point off-centre for tube-like even harmonics.*/
+    static constexpr double bias = 0.2;
+
+    /*
+    Below this input difference the divided differences lose too many digits,
+    so we fall back to evaluating the curve (or F1) at the midpoint.
+    */
+    static constexpr double tolerance = 1.0e-4;
+
+    template <typename Value>
+    static Value curve(Value u) noexcept
+    {
+        auto clipped = adaaMin(Value(1.0), adaaMax(Value(-1.0), u));
+        return clipped - clipped * clipped * clipped * Value(1.0 / 3.0);
+    }
+
+    //Even: a^2/2 - a^4/12 inside the knee, 2a/3 - 1/4 outside
+    template <typename Value>
+    static Value firstAntiderivative(Value u) noexcept
+    {
+        auto a = adaaAbs(u);
+        auto inside = adaaMin(a, Value(1.0));
+        auto squared = inside * inside;
+
+        return squared * Value(0.5) - squared * squared * Value(1.0 / 12.0) + Value(2.0 / 3.0) * (a - inside);
+    }
+
+    //Odd: a^3/6 - a^5/60 inside the knee, a^2/3 - a/4 + 1/15 outside
+    template <typename Value>
+    static Value secondAntiderivative(Value u) noexcept
+    {
+        auto a = adaaAbs(u);
+        auto inside = adaaMin(a, Value(1.0));
+        auto cubed = inside * inside * inside;
+        auto outside = a - inside;
+
+        return adaaCopySign(cubed * Value(1.0 / 6.0) - cubed * inside * inside * Value(1.0 / 60.0)
+            + outside * (Value(5.0 / 12.0) + outside * Value(1.0 / 3.0)), u);
+    }
+};
+
+/*
+ADAA state for up to Lanes channels processed side by side.
+
+Each call copies a tile of samples from the channels into a local
+[sample][lane] array, then runs the kernel down the tile one ADAAVector of
+lanes at a time, and copies the result back. Only the registers that hold
+live channels run, so with SSE2 or NEON a mono or stereo track costs one
+register's worth of work rather than the full group. Lanes in a live
+register that have no channel run on silence.
+*/
+template <int Lanes>
+struct ADAALanes
+{
+    static_assert(Lanes % ADAAVector::size == 0, "Lanes must fill whole registers");
+
+    static constexpr int tileSize = 32;
+
+    void reset() noexcept
+    {
+        //Silence sits at the bias point, not at zero
+        for (int lane = 0; lane < Lanes; ++lane)
+        {
+            previousInput[lane] = SoftClipCurve::bias;
+            secondPreviousInput[lane] = SoftClipCurve::bias;
+            previousF1[lane] = SoftClipCurve::firstAntiderivative(SoftClipCurve::bias);
+            previousF2[lane] = SoftClipCurve::secondAntiderivative(SoftClipCurve::bias);
+            previousDividedDifference[lane] = SoftClipCurve::firstAntiderivative(SoftClipCurve::bias);
+        }
+    }
+
+    /*
+    Saturates numChannels (<= Lanes) channels in place. Drive ramps linearly
+    from startDrive to endDrive over the block, reaching endDrive on the last
+    sample.
+    */
+    template <int Order>
+    void process(float* const* channels, int numChannels, int numSamples,
+                 double startDrive, double endDrive) noexcept
+    {
+        static_assert(Order == 1 || Order == 2, "ADAA is implemented for first and second order");
+
+        //Removes the DC the bias would otherwise add, and undoes the drive for small signals
+        const auto offset = SoftClipCurve::curve(SoftClipCurve::bias);
+        const auto driveStep = numSamples > 0 ? (endDrive - startDrive) / numSamples : 0.0;
+
+        const auto numRegisters = (numChannels + ADAAVector::size - 1) / ADAAVector::size;
+        const auto numLanes = numRegisters * ADAAVector::size;
+
+        alignas(32) double tile[tileSize][Lanes];
+        double drive[tileSize], makeUp[tileSize];
+
+        for (int start = 0; start < numSamples; start += tileSize)
+        {
+            auto tileLength = std::min(tileSize, numSamples - start);
+
+            //Shared by every lane, so it is worked out once per tile
+            for (int i = 0; i < tileLength; ++i)
+            {
+                drive[i] = startDrive + driveStep * (start + i + 1);
+                makeUp[i] = 1.0 / drive[i];
+            }
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                if (lane < numChannels)
+                    for (int i = 0; i < tileLength; ++i)
+                        tile[i][lane] = drive[i] * channels[lane][start + i] + SoftClipCurve::bias;
+                else
+                    for (int i = 0; i < tileLength; ++i)
+                        tile[i][lane] = SoftClipCurve::bias;
+            }
+
+            for (int lane = 0; lane < numLanes; lane += ADAAVector::size)
+            {
+                if (Order == 1)
+                    processFirstOrder(tile, tileLength, lane);
+                else
+                    processSecondOrder(tile, tileLength, lane);
+            }
+
+            for (int lane = 0; lane < numChannels; ++lane)
+                for (int i = 0; i < tileLength; ++i)
+                    channels[lane][start + i] = (float)((tile[i][lane] - offset) * makeUp[i]);
+        }
+    }
+
+private:
+    using Vector = ADAAVector;
+
+    /*
+    y[n] = (F1(u[n]) - F1(u[n-1])) / (u[n] - u[n-1])
+    Runs one register of lanes, starting at firstLane.
+    */
+    void processFirstOrder(double (&tile)[tileSize][Lanes], int numSamples, int firstLane) noexcept
+    {
+        const Vector tolerance(SoftClipCurve::tolerance), one(1.0), half(0.5);
+
+        auto u1 = Vector::load(previousInput + firstLane);
+        auto F1u1 = Vector::load(previousF1 + firstLane);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto u0 = Vector::load(&tile[i][firstLane]);
+            auto F1u0 = SoftClipCurve::firstAntiderivative(u0);
+            auto difference = u0 - u1;
+            auto illConditioned = lessThan(adaaAbs(difference), tolerance);
+
+            auto regular = (F1u0 - F1u1) / select(illConditioned, one, difference);
+            auto fallback = SoftClipCurve::curve(half * (u0 + u1));
+
+            select(illConditioned, fallback, regular).store(&tile[i][firstLane]);
+
+            u1 = u0;
+            F1u1 = F1u0;
+        }
+
+        u1.store(previousInput + firstLane);
+        F1u1.store(previousF1 + firstLane);
+    }
+
+    /*
+    y[n] = 2 / (u[n] - u[n-2]) * (D1(u[n], u[n-1]) - D1(u[n-1], u[n-2])),
+    where D1(a, b) = (F2(a) - F2(b)) / (a - b).
+    When u[n] ~ u[n-2] we expand around their midpoint instead. Both sides of
+    every fallback are computed and the mask picks one per lane.
+    */
+    void processSecondOrder(double (&tile)[tileSize][Lanes], int numSamples, int firstLane) noexcept
+    {
+        const Vector tolerance(SoftClipCurve::tolerance), one(1.0), two(2.0), half(0.5);
+
+        auto u1 = Vector::load(previousInput + firstLane);
+        auto u2 = Vector::load(secondPreviousInput + firstLane);
+        auto F2u1 = Vector::load(previousF2 + firstLane);
+        auto D1Previous = Vector::load(previousDividedDifference + firstLane);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto u0 = Vector::load(&tile[i][firstLane]);
+            auto F2u0 = SoftClipCurve::secondAntiderivative(u0);
+
+            auto difference01 = u0 - u1;
+            auto illConditioned01 = lessThan(adaaAbs(difference01), tolerance);
+            auto D1 = select(illConditioned01,
+                SoftClipCurve::firstAntiderivative(half * (u0 + u1)),
+                (F2u0 - F2u1) / select(illConditioned01, one, difference01));
+
+            auto difference02 = u0 - u2;
+            auto illConditioned02 = lessThan(adaaAbs(difference02), tolerance);
+            auto regular = two * (D1 - D1Previous) / select(illConditioned02, one, difference02);
+
+            auto midpoint = half * (u0 + u2);
+            auto delta = midpoint - u1;
+            auto illConditionedDelta = lessThan(adaaAbs(delta), tolerance);
+            auto inverseDelta = one / select(illConditionedDelta, one, delta);
+            auto expanded = select(illConditionedDelta,
+                SoftClipCurve::curve(half * (midpoint + u1)),
+                two * inverseDelta * (SoftClipCurve::firstAntiderivative(midpoint)
+                    + (F2u1 - SoftClipCurve::secondAntiderivative(midpoint)) * inverseDelta));
+
+            select(illConditioned02, expanded, regular).store(&tile[i][firstLane]);
+
+            u2 = u1;
+            u1 = u0;
+            F2u1 = F2u0;
+            D1Previous = D1;
+        }
+
+        u1.store(previousInput + firstLane);
+        u2.store(secondPreviousInput + firstLane);
+        F2u1.store(previousF2 + firstLane);
+        D1Previous.store(previousDividedDifference + firstLane);
+    }
+
+    //Stored in the shifted (driven + biased) domain
+    alignas(32) double previousInput[Lanes];
+    alignas(32) double secondPreviousInput[Lanes];
+    alignas(32) double previousF1[Lanes];
+    alignas(32) double previousF2[Lanes];
+    alignas(32) double previousDividedDifference[Lanes];
+};
@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    ChannelGroupWorkers.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelGroupWorkers.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+/*Idle workers spin for this fraction of a block before sleeping on their event.*/
+static constexpr double spinFractionOfBlock = 0.25;
+
+static inline void spinPause() noexcept
+{
+   #if JUCE_INTEL
+    _mm_pause();
+   #elif JUCE_ARM && (JUCE_CLANG || JUCE_GCC)
+    __asm__ __volatile__ ("yield");
+   #endif
+}
+
+//==============================================================================
+class ChannelGroupWorkers::Worker : public juce::Thread
+{
+public:
+    Worker(ChannelGroupWorkers& o, int index)
+        : juce::Thread("SimpleEQ channel worker " + juce::String(index)),
+          owner(o)
+    {
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(1000);
+    }
+
+    void start()
+    {
+       #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+        if (startRealtimeThread(juce::Thread::RealtimeOptions{}.withPeriodMs(owner.blockDurationMs)))
+            return;
+       #endif
+
+        startThread(juce::Thread::Priority::highest);
+    }
+
+    /*Only touches the kernel when the worker has actually gone to sleep.*/
+    void wake() noexcept
+    {
+        if (sleeping.load())
+            wakeUp.signal();
+    }
+
+    void run() override
+    {
+        auto lastGeneration = getGeneration(owner.work.load());
+
+        while (! threadShouldExit())
+        {
+           #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+            rejoinWorkgroupIfChanged();
+           #endif
+
+            auto generation = waitForNewGeneration(lastGeneration);
+
+            if (threadShouldExit())
+                break;
+
+            lastGeneration = generation;
+            owner.processGroups(generation);
+        }
+    }
+
+private:
+    juce::uint32 waitForNewGeneration(juce::uint32 lastGeneration)
+    {
+        const auto spinMs = owner.blockDurationMs * spinFractionOfBlock;
+        auto spinUntil = juce::Time::getMillisecondCounterHiRes() + spinMs;
+
+        for (int spins = 0;; ++spins)
+        {
+            auto generation = getGeneration(owner.work.load());
+
+            if (generation != lastGeneration || threadShouldExit())
+                return generation;
+
+            //Reading the clock on every iteration would cost more than the spin itself
+            if ((spins & 63) != 0 || juce::Time::getMillisecondCounterHiRes() < spinUntil)
+            {
+                spinPause();
+                continue;
+            }
+
+            /*
+            Publish `sleeping` before re-checking the generation; run() publishes the
+            generation before reading `sleeping`, so one of us always sees the other.
+            */
+            sleeping.store(true);
+
+            if (getGeneration(owner.work.load()) == lastGeneration && ! threadShouldExit())
+                wakeUp.wait(100);
+
+            sleeping.store(false);
+            spinUntil = juce::Time::getMillisecondCounterHiRes() + spinMs;
+        }
+    }
+
+   #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+    void rejoinWorkgroupIfChanged()
+    {
+        auto version = owner.workgroupVersion.load();
+
+        if (version == joinedWorkgroupVersion)
+            return;
+
+        juce::AudioWorkgroup workgroup;
+
+        {
+            const juce::SpinLock::ScopedLockType lock(owner.workgroupLock);
+            workgroup = owner.workgroup;
+        }
+
+        workgroupToken.reset();
+
+        if (workgroup)
+            workgroup.join(workgroupToken);
+
+        joinedWorkgroupVersion = version;
+    }
+
+    juce::WorkgroupToken workgroupToken;
+    juce::uint32 joinedWorkgroupVersion = 0;
+   #endif
+
+    ChannelGroupWorkers& owner;
+    std::atomic<bool> sleeping{ false };
+    juce::WaitableEvent wakeUp;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Worker)
+};
+
+//==============================================================================
+ChannelGroupWorkers::ChannelGroupWorkers()
+{
+}
+
+ChannelGroupWorkers::~ChannelGroupWorkers()
+{
+    release();
+}
+
+void ChannelGroupWorkers::prepare(int numWorkersToUse, double sampleRate, int samplesPerBlock)
+{
+    const juce::ScopedLock lock(workersLock);
+
+    auto newBlockDurationMs = sampleRate > 0.0 ? 1000.0 * samplesPerBlock / sampleRate : 0.0;
+
+    if (workers.size() == numWorkersToUse && newBlockDurationMs == blockDurationMs)
+        return;
+
+    workers.clear();
+
+    blockDurationMs = newBlockDurationMs;
+
+    for (int i = 0; i < numWorkersToUse; ++i)
+        workers.add(new Worker(*this, i))->start();
+}
+
+void ChannelGroupWorkers::release()
+{
+    const juce::ScopedLock lock(workersLock);
+
+    //Each Worker stops its own thread on destruction
+    workers.clear();
+}
+
+#if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+void ChannelGroupWorkers::setWorkgroup(const juce::AudioWorkgroup& newWorkgroup)
+{
+    {
+        const juce::SpinLock::ScopedLockType lock(workgroupLock);
+        workgroup = newWorkgroup;
+    }
+
+    ++workgroupVersion;
+}
+#endif
+
+void ChannelGroupWorkers::run(Job& job, int numGroups, double deadlineMs) noexcept
+{
+    if (numGroups <= 0)
+        return;
+
+    jassert(numGroups <= maxNumGroups);
+
+    //Never wait for the message thread: if the pool is being rebuilt, go serial for this block
+    const juce::ScopedTryLock lock(workersLock);
+
+    //Nothing to share, so don't pay for the fork/join
+    if (! lock.isLocked() || workers.isEmpty() || numGroups == 1)
+    {
+        for (int group = 0; group < numGroups; ++group)
+            job.processGroup(group);
+
+        return;
+    }
+
+    auto generation = getGeneration(work.load()) + 1;
+
+    currentJob = &job;
+    groupsRemaining = numGroups;
+    work.store(makeWork(generation, (juce::uint32)numGroups, 0));
+
+    for (auto* worker : workers)
+        worker->wake();
+
+    //The audio thread works too, rather than just waiting
+    processGroups(generation);
+
+    /*
+    Every group has been claimed by now; only the ones already running on
+    workers are left. Spin on them until the block deadline. Past it the block
+    is late whatever we do, so sleep until the last worker signals rather than
+    keep a core busy that a preempted worker may need.
+    */
+    for (int spins = 0; groupsRemaining.load() > 0; ++spins)
+    {
+        if ((spins & 63) != 0 || juce::Time::getMillisecondCounterHiRes() < deadlineMs)
+        {
+            spinPause();
+            continue;
+        }
+
+        //Same handshake as the workers' sleep: publish the flag, then re-check
+        audioThreadWaiting.store(true);
+
+        while (groupsRemaining.load() > 0)
+            groupsFinished.wait(1);
+
+        audioThreadWaiting.store(false);
+        groupsFinished.reset();
+    }
+}
+
+void ChannelGroupWorkers::processGroups(juce::uint32 generation) noexcept
+{
+    for (;;)
+    {
+        auto current = work.load();
+
+        if (getGeneration(current) != generation)
+            return;
+
+        auto group = getNextGroup(current);
+
+        if (group >= getNumGroups(current))
+            return;
+
+        if (work.compare_exchange_weak(current, current + 1))
+        {
+            currentJob.load()->processGroup((int)group);
+
+            if (--groupsRemaining == 0 && audioThreadWaiting.load())
+                groupsFinished.signal();
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    ChannelGroupWorkers.h
+
+    A small pool of real-time worker threads that share the processing of
+    independent channel groups with the host's audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//AudioWorkgroup and Thread::RealtimeOptions arrived in JUCE 7.0.6
+#if JUCE_MAJOR_VERSION > 7 || (JUCE_MAJOR_VERSION == 7 && (JUCE_MINOR_VERSION > 0 || JUCE_BUILDNUMBER >= 6))
+ #define SIMPLEEQ_HAS_AUDIO_WORKGROUPS 1
+#else
+ #define SIMPLEEQ_HAS_AUDIO_WORKGROUPS 0
+#endif
+
+/*
+Fork/join helper for processBlock.
+
+run() publishes a job, lets the workers and the calling (audio) thread claim
+groups from a single lock-free counter, and returns once every group is done.
+Idle workers spin for a fraction of the block duration before going to sleep,
+so back-to-back blocks never pay for a kernel wake-up.
+
+Because the audio thread claims from the same counter, any group that no
+worker has picked up yet is simply processed on the audio thread. By the time
+it waits, the only groups left are ones a worker is already running. It spins
+on those until the block deadline, then blocks on an event instead, so a
+preempted worker isn't competing with a busy-waiting audio thread.
+*/
+class ChannelGroupWorkers
+{
+public:
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void processGroup(int groupIndex) noexcept = 0;
+    };
+
+    ChannelGroupWorkers();
+    ~ChannelGroupWorkers();
+
+    /*
+    Not real-time safe: starts, stops or restarts threads until numWorkersToUse
+    are running for this block duration, and does nothing if they already are.
+    The check and the restart happen under one lock, so this may race release()
+    from another thread. While either is running, run() falls back to processing
+    everything on the calling thread.
+    */
+    void prepare(int numWorkersToUse, double sampleRate, int samplesPerBlock);
+    void release();
+
+   #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+    /*Called from AudioProcessor::audioWorkgroupContextChanged(); workers rejoin on their next wake-up.*/
+    void setWorkgroup(const juce::AudioWorkgroup& newWorkgroup);
+   #endif
+
+    /*
+    Processes groups [0, numGroups) of the job and blocks until all are done.
+    numGroups must not exceed 65535.
+    deadlineMs is on the Time::getMillisecondCounterHiRes() clock, normally the
+    start of processBlock plus the length of this block.
+    */
+    void run(Job& job, int numGroups, double deadlineMs) noexcept;
+
+private:
+    class Worker;
+
+    /*
+    The generation lives in the upper 32 bits, the block's group count in the next
+    16 and the next unclaimed group in the lowest 16. A worker reads all three in
+    one load, so one that wakes up late can never claim a group of a newer block,
+    nor check its claim against another block's count. Claiming adds one, and
+    never carries into the count because nextGroup stops at numGroups.
+    */
+    static constexpr int maxNumGroups = 0xffff;
+
+    static juce::uint64 makeWork(juce::uint32 generation, juce::uint32 numGroups, juce::uint32 nextGroup) noexcept
+    {
+        return ((juce::uint64)generation << 32) | ((juce::uint64)numGroups << 16) | nextGroup;
+    }
+
+    static juce::uint32 getGeneration(juce::uint64 work) noexcept { return (juce::uint32)(work >> 32); }
+    static juce::uint32 getNumGroups(juce::uint64 work) noexcept { return (juce::uint32)(work >> 16) & 0xffff; }
+    static juce::uint32 getNextGroup(juce::uint64 work) noexcept { return (juce::uint32)work & 0xffff; }
+
+    void processGroups(juce::uint32 generation) noexcept;
+
+    std::atomic<juce::uint64> work{ 0 };
+    std::atomic<int> groupsRemaining{ 0 };
+
+    //Set while the audio thread sleeps past the deadline; the last worker to finish signals it
+    std::atomic<bool> audioThreadWaiting{ false };
+    juce::WaitableEvent groupsFinished;
+
+    //Held while workers start or stop; run() only ever try-locks it
+    juce::CriticalSection workersLock;
+
+    /*
+    Written before `work` is published. A worker only reads it after a successful
+    claim, and the next block can't be published until that claimed group is done.
+    */
+    std::atomic<Job*> currentJob{ nullptr };
+
+    double blockDurationMs = 0.0;
+
+   #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+    juce::SpinLock workgroupLock;
+    juce::AudioWorkgroup workgroup;
+    std::atomic<juce::uint32> workgroupVersion{ 0 };
+   #endif
+
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelGroupWorkers)
+};
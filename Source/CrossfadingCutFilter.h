@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    CrossfadingCutFilter.h
+
+    Wraps a cut filter cascade so that slope changes don't click. Two copies
+    of the cascade exist, but only one runs outside of a transition.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+When the slope changes, the idle copy of the cascade is reset and given the
+new configuration. It then runs silently on the live signal for a prewarm
+period, long enough for its start-up transient to die away, and is
+crossfaded in over the outgoing copy. Once the fade completes the copies
+swap roles and we are back to running a single cascade.
+
+Once the fade has started, both copies are audible, so another slope change
+has to wait: canBeginTransition() says when the caller may start the next one.
+*/
+template <typename CutFilterType>
+class CrossfadingCutFilter
+{
+public:
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        for (auto& cut : cuts)
+            cut.prepare(spec);
+
+        outgoingBuffer.setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+
+        sampleRate = spec.sampleRate;
+        prewarmLength = juce::roundToInt(sampleRate * minPrewarmSeconds);
+        fadeLength = juce::jmax(1, juce::roundToInt(spec.sampleRate * fadeSeconds));
+        finishTransition();
+    }
+
+    void reset()
+    {
+        for (auto& cut : cuts)
+            cut.reset();
+
+        finishTransition();
+    }
+
+    bool isTransitioning() const noexcept { return transitionPosition < prewarmLength + fadeLength; }
+
+    /*The cascade that parameter updates should go to: the incoming one while fading.*/
+    CutFilterType& getTarget() noexcept
+    {
+        return cuts[isTransitioning() ? 1 - active : active];
+    }
+
+    /*
+    The cascade that is audible now: the outgoing one while fading. It keeps its
+    own slope, so callers must design its coefficients for that slope.
+    */
+    CutFilterType& getActive() noexcept { return cuts[active]; }
+
+    /*False while fading: the incoming cascade is audible and can't be reconfigured.*/
+    bool canBeginTransition() const noexcept
+    {
+        return ! isTransitioning() || transitionPosition < prewarmLength;
+    }
+
+    /*
+    Starts a transition and returns the cascade to configure with the new slope.
+    Only call this when canBeginTransition() is true. During the prewarm the
+    incoming cascade is still silent, so it is simply reset and the prewarm
+    restarts for the new configuration.
+    */
+    CutFilterType& beginTransition(float cutoffFrequency, int order) noexcept
+    {
+        jassert(canBeginTransition());
+
+        auto& incoming = cuts[1 - active];
+
+        incoming.reset();
+        prewarmLength = getPrewarmLength(cutoffFrequency, order);
+        transitionPosition = 0;
+
+        return incoming;
+    }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        if (! isTransitioning())
+        {
+            cuts[active].process(context);
+            return;
+        }
+
+        auto& outputBlock = context.getOutputBlock();
+        auto numSamples = outputBlock.getNumSamples();
+        auto numChannels = outputBlock.getNumChannels();
+
+        //Run the outgoing cascade on a copy of the input...
+        auto outgoingBlock = juce::dsp::AudioBlock<float>(outgoingBuffer)
+            .getSubsetChannelBlock(0, numChannels)
+            .getSubBlock(0, numSamples);
+
+        outgoingBlock.copyFrom(context.getInputBlock());
+        cuts[active].process(juce::dsp::ProcessContextReplacing<float>(outgoingBlock));
+
+        //...and the incoming one in place, then mix
+        cuts[1 - active].process(context);
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            auto* incoming = outputBlock.getChannelPointer(channel);
+            auto* outgoing = outgoingBlock.getChannelPointer(channel);
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto fadePosition = transitionPosition + (int)i - prewarmLength;
+                auto gain = juce::jlimit(0.f, 1.f, (float)(fadePosition + 1) / (float)fadeLength);
+
+                incoming[i] = outgoing[i] + gain * (incoming[i] - outgoing[i]);
+            }
+        }
+
+        transitionPosition += (int)numSamples;
+
+        if (! isTransitioning())
+            active = 1 - active;
+    }
+
+private:
+    void finishTransition() noexcept
+    {
+        transitionPosition = prewarmLength + fadeLength;
+    }
+
+    /*
+    The slowest-decaying pole of an order-N Butterworth sits at
+    wc * sin(pi / 2N) from the imaginary axis, so low cutoffs and steep slopes
+    ring for longest. Wait prewarmTimeConstants of it (about 60 dB of decay).
+    */
+    int getPrewarmLength(float cutoffFrequency, int order) const noexcept
+    {
+        auto slowestDecay = juce::MathConstants<double>::twoPi * cutoffFrequency
+            * std::sin(juce::MathConstants<double>::pi / (2.0 * juce::jmax(1, order)));
+        auto seconds = juce::jlimit(minPrewarmSeconds, maxPrewarmSeconds,
+            prewarmTimeConstants / juce::jmax(slowestDecay, 1.0e-3));
+
+        return juce::roundToInt(sampleRate * seconds);
+    }
+
+    static constexpr double prewarmTimeConstants = 7.0;
+    static constexpr double minPrewarmSeconds = 0.02;
+    static constexpr double maxPrewarmSeconds = 0.5;
+    static constexpr double fadeSeconds = 0.02;
+
+    double sampleRate = 44100.0;
+
+    CutFilterType cuts[2];
+    int active = 0;
+
+    int prewarmLength = 0, fadeLength = 1;
+    int transitionPosition = 1;
+
+    juce::AudioBuffer<float> outgoingBuffer;
+};
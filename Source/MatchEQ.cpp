@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    MatchEQ.cpp
+
+  ==============================================================================
+*/
+
+#include "MatchEQ.h"
+#include "MatchEQFit.h"
+
+//==============================================================================
+MatchEQAnalyzer::MatchEQAnalyzer()
+    : juce::Thread("SimpleEQ Match EQ"),
+      pool(juce::jmax(1, juce::SystemStats::getNumCpus()))
+{
+    formatManager.registerBasicFormats();
+}
+
+MatchEQAnalyzer::~MatchEQAnalyzer()
+{
+    //Stop the thread first, or it could trigger another update after we cancel it
+    signalThreadShouldExit();
+    cancelled = true;
+    stopThread(10000);
+    cancelPendingUpdate();
+}
+
+void MatchEQAnalyzer::start(const juce::File& reference, const juce::File& target,
+                            double sampleRateToFitFor, Callback onComplete)
+{
+    //One analyzer per analysis, so a second start is a bug in the caller
+    jassert(! isThreadRunning());
+
+    referenceFile = reference;
+    targetFile = target;
+    fitSampleRate = sampleRateToFitFor > 0.0 ? sampleRateToFitFor : 48000.0;
+    callback = std::move(onComplete);
+    cancelled = false;
+
+    startThread(juce::Thread::Priority::background);
+}
+
+void MatchEQAnalyzer::run()
+{
+    ChainSettings fitted;
+    result = analyseFiles(fitted);
+    fittedSettings = fitted;
+
+    if (! threadShouldExit())
+        triggerAsyncUpdate();
+}
+
+/*Takes copies first, because the callback is allowed to delete us.*/
+void MatchEQAnalyzer::handleAsyncUpdate()
+{
+    auto onComplete = std::move(callback);
+    auto finalResult = result;
+    auto settings = fittedSettings;
+
+    if (onComplete != nullptr)
+        onComplete(finalResult, settings);
+}
+
+/*
+Runs job(0) ... job(numJobs - 1) on the pool and waits for all of them.
+Returns false if the analysis was cancelled meanwhile.
+*/
+bool MatchEQAnalyzer::runOnPool(int numJobs, const std::function<void(int)>& job)
+{
+    std::atomic<int> remaining{ numJobs };
+    juce::WaitableEvent finished;
+
+    for (int i = 0; i < numJobs; ++i)
+    {
+        pool.addJob([&job, &remaining, &finished, i]
+        {
+            job(i);
+
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+
+    while (! finished.wait(50))
+        if (threadShouldExit())
+            cancelled = true;
+
+    return ! cancelled;
+}
+
+juce::Result MatchEQAnalyzer::analyseFiles(ChainSettings& fitted)
+{
+    Spectrum reference, target;
+    auto spectraResult = computeSpectra(reference, target);
+
+    if (spectraResult.failed())
+        return spectraResult;
+
+    auto points = MatchEQFit::makePoints(MatchEQFit::smoothToGrid(reference.power, reference.sampleRate, fftSize),
+                                         MatchEQFit::smoothToGrid(target.power, target.sampleRate, fftSize));
+
+    if (points.size() < 8)
+        return juce::Result::fail("Not enough shared, non-silent bandwidth to match");
+
+    double start[Fit_NumParameters];
+    MatchEQFit::initialGuess(points, start);
+
+    //Every pair of cut slopes is an independent fit from the same start, so run them all at once
+    struct SlopeFit
+    {
+        double p[Fit_NumParameters];
+        double cost;
+    };
+
+    constexpr int numSlopes = MatchEQFit::numSlopes;
+    SlopeFit fits[numSlopes * numSlopes];
+
+    auto allFitted = runOnPool(numSlopes * numSlopes, [&](int index)
+    {
+        auto& fit = fits[index];
+        std::copy(start, start + Fit_NumParameters, fit.p);
+
+        fit.cost = MatchEQFit::fitBands(fit.p, index / numSlopes, index % numSlopes, points, fitSampleRate);
+    });
+
+    if (! allFitted)
+        return juce::Result::fail("Cancelled");
+
+    auto best = 0;
+
+    for (int index = 1; index < numSlopes * numSlopes; ++index)
+        if (fits[index].cost < fits[best].cost)
+            best = index;
+
+    auto& bestFit = fits[best].p;
+
+    fitted.lowCutFreq = (float)std::exp(bestFit[Fit_LogLowCutFreq]);
+    fitted.highCutFreq = (float)std::exp(bestFit[Fit_LogHighCutFreq]);
+    fitted.peakFreq = (float)std::exp(bestFit[Fit_LogPeakFreq]);
+    fitted.peakGainInDecibels = (float)bestFit[Fit_PeakGain];
+    fitted.peakQuality = (float)std::exp(bestFit[Fit_LogPeakQ]);
+    fitted.lowCutSlope = static_cast<Slope>(best / numSlopes);
+    fitted.highCutSlope = static_cast<Slope>(best % numSlopes);
+
+    return juce::Result::ok();
+}
+
+/*
+Splits both files into one segment per pool thread and queues them all at
+once, so the reference and target are analysed concurrently.
+*/
+juce::Result MatchEQAnalyzer::computeSpectra(Spectrum& reference, Spectrum& target)
+{
+    struct Segment
+    {
+        const juce::File* file;
+        Spectrum* spectrum;
+        juce::int64 firstFrame, endFrame;
+        std::vector<double> power;
+    };
+
+    std::vector<Segment> segments;
+    auto numSegmentsPerFile = (juce::int64)pool.getNumThreads();
+
+    for (auto [file, spectrum] : { std::make_pair(&referenceFile, &reference), std::make_pair(&targetFile, &target) })
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(*file));
+
+        if (reader == nullptr)
+            return juce::Result::fail("Couldn't read " + file->getFullPathName());
+
+        auto length = reader->lengthInSamples;
+
+        if (length <= 0)
+            return juce::Result::fail(file->getFileName() + " is empty");
+
+        spectrum->sampleRate = reader->sampleRate;
+        spectrum->power.assign(fftSize / 2 + 1, 0.0);
+
+        //Short files still get one zero-padded frame
+        spectrum->numFrames = juce::jmax((juce::int64)1, (length - fftSize) / hopSize + 1);
+
+        auto numSegments = juce::jmin(numSegmentsPerFile, spectrum->numFrames);
+
+        for (juce::int64 i = 0; i < numSegments; ++i)
+            segments.push_back({ file, spectrum,
+                                 spectrum->numFrames * i / numSegments,
+                                 spectrum->numFrames * (i + 1) / numSegments,
+                                 {} });
+    }
+
+    auto allRead = runOnPool((int)segments.size(), [this, &segments](int index)
+    {
+        auto& segment = segments[(size_t)index];
+        accumulateSegment(*segment.file, segment.firstFrame, segment.endFrame, segment.power);
+    });
+
+    if (! allRead)
+        return juce::Result::fail("Cancelled");
+
+    for (auto& segment : segments)
+        for (size_t bin = 0; bin < segment.power.size(); ++bin)
+            segment.spectrum->power[bin] += segment.power[bin];
+
+    for (auto* spectrum : { &reference, &target })
+        for (auto& bin : spectrum->power)
+            bin /= (double)spectrum->numFrames;
+
+    return juce::Result::ok();
+}
+
+/*
+Runs on a pool thread. Only ever holds one FFT frame plus one hop of
+interleaved input, no matter how long the file is.
+*/
+void MatchEQAnalyzer::accumulateSegment(const juce::File& file, juce::int64 firstFrame, juce::int64 endFrame,
+                                        std::vector<double>& power)
+{
+    power.assign(fftSize / 2 + 1, 0.0);
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr)
+        return;
+
+    juce::dsp::FFT fft(fftOrder);
+    juce::dsp::WindowingFunction<float> window((size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false);
+
+    juce::AudioBuffer<float> chunk((int)reader->numChannels, hopSize);
+    std::vector<float> frame((size_t)fftSize), fftData(2 * (size_t)fftSize);
+
+    //Reads one hop and downmixes it to mono; the reader zero-pads past the end of the file
+    auto readHop = [&](juce::int64 position, float* destination)
+    {
+        reader->read(&chunk, 0, hopSize, position, true, true);
+
+        juce::FloatVectorOperations::copy(destination, chunk.getReadPointer(0), hopSize);
+
+        for (int channel = 1; channel < chunk.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::add(destination, chunk.getReadPointer(channel), hopSize);
+
+        juce::FloatVectorOperations::multiply(destination, 1.f / (float)chunk.getNumChannels(), hopSize);
+    };
+
+    auto position = firstFrame * hopSize;
+    readHop(position, frame.data());
+    readHop(position + hopSize, frame.data() + hopSize);
+
+    for (auto index = firstFrame; index < endFrame && ! cancelled; ++index)
+    {
+        std::copy(frame.begin(), frame.end(), fftData.begin());
+        window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+        fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+        for (size_t bin = 0; bin < power.size(); ++bin)
+            power[bin] += (double)fftData[bin] * (double)fftData[bin];
+
+        //Slide the frame along by one hop
+        std::copy(frame.begin() + hopSize, frame.end(), frame.begin());
+        position += hopSize;
+        readHop(position + hopSize, frame.data() + hopSize);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    MatchEQ.h
+
+    Background analysis that compares the long-term spectrum of a reference
+    file against a target file and fits the difference onto the EQ's bands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "PluginProcessor.h"
+
+/*
+Both files are streamed through a Welch-style averaged FFT in constant
+memory. Each file is split into segments that run on a thread pool, and
+each segment opens its own reader. The averaged spectra are smoothed to
+1/3 octave on a log-frequency grid. A small Levenberg-Marquardt solver
+then fits the low cut, high cut and peak band to the difference. Every pair
+of cut slopes is fitted on the pool in parallel, and the best fit wins.
+
+The callback always runs on the message thread, and may delete the analyzer.
+The pool's threads live as long as the analyzer, so create one per analysis.
+*/
+class MatchEQAnalyzer : private juce::Thread,
+                        private juce::AsyncUpdater
+{
+public:
+    using Callback = std::function<void(const juce::Result&, const ChainSettings&)>;
+
+    MatchEQAnalyzer();
+    ~MatchEQAnalyzer() override;
+
+    /*Call once per analyzer; the callback always arrives, even when the analysis fails.*/
+    void start(const juce::File& referenceFile, const juce::File& targetFile,
+               double sampleRateToFitFor, Callback onComplete);
+
+private:
+    struct Spectrum
+    {
+        std::vector<double> power;
+        double sampleRate = 0.0;
+        juce::int64 numFrames = 0;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    bool runOnPool(int numJobs, const std::function<void(int)>& job);
+
+    juce::Result analyseFiles(ChainSettings& fitted);
+    juce::Result computeSpectra(Spectrum& reference, Spectrum& target);
+    void accumulateSegment(const juce::File& file, juce::int64 firstFrame, juce::int64 endFrame,
+                           std::vector<double>& power);
+
+    //2.9 Hz bins at 48 kHz; coarser bins smear an 80 Hz cut enough to bias the fit
+    static constexpr int fftOrder = 14;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 2;
+
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool pool;
+    std::atomic<bool> cancelled{ false };
+
+    juce::File referenceFile, targetFile;
+    double fitSampleRate = 48000.0;
+    Callback callback;
+
+    //Written by the analysis thread before it triggers the async update
+    juce::Result result{ juce::Result::ok() };
+    ChainSettings fittedSettings;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MatchEQAnalyzer)
+};
@@ -0,0 +1,347 @@
+/*
+  ==============================================================================
+
+    MatchEQFit.h
+
+    Spectrum smoothing and the band fit behind the Match EQ. Deliberately free
+    of JUCE so Benchmarks/MatchEQPipelineBenchmark.cpp can run the exact fit
+    the plugin runs without the rest of the project.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/*Log-domain parameters keep the solver's steps proportional for frequencies and Q.*/
+enum FitParameter
+{
+    Fit_LogLowCutFreq,
+    Fit_LogHighCutFreq,
+    Fit_LogPeakFreq,
+    Fit_PeakGain,
+    Fit_LogPeakQ,
+    Fit_Offset,     //broadband level difference, which the EQ can't (and shouldn't) match
+    Fit_NumParameters
+};
+
+struct FitPoint
+{
+    double frequency, differenceInDecibels;
+};
+
+/*
+Band model used by the fit. These are the magnitude responses of the filters
+the processor actually builds (bilinear Butterworth cuts, RBJ peak), evaluated
+with tan() prewarping instead of building coefficient objects for every point.
+Slopes are indices into the Slope enum: 0 is 12 dB/oct, 3 is 48 dB/oct.
+*/
+struct MatchEQFit
+{
+    static constexpr int numSlopes = 4;
+
+    //1/10 octave spacing from 20 Hz to 20 kHz
+    static constexpr int numGridPoints = 100;
+    static constexpr double lowestGridFrequency = 20.0, highestGridFrequency = 20000.0;
+
+    static double getGridFrequency(int index)
+    {
+        return lowestGridFrequency
+            * std::pow(highestGridFrequency / lowestGridFrequency, (double)index / (numGridPoints - 1));
+    }
+
+    /*
+    Averages an FFT power spectrum (fftSize / 2 + 1 bins) over 1/3 octave around
+    each grid point. The average is taken in dB, so a steep cut's slope, which is
+    straight in dB, isn't dragged towards its loudest bins. Points with nothing
+    to measure come back as NaN.
+    */
+    static std::vector<double> smoothToGrid(const std::vector<double>& power, double sampleRate, int fftSize)
+    {
+        std::vector<double> decibels((size_t)numGridPoints, std::numeric_limits<double>::quiet_NaN());
+
+        const auto binWidth = sampleRate / fftSize;
+        const auto lastBin = (int)power.size() - 1;
+        const auto halfBandwidth = std::pow(2.0, 1.0 / 6.0);
+
+        for (int i = 0; i < numGridPoints; ++i)
+        {
+            auto frequency = getGridFrequency(i);
+
+            if (frequency > 0.45 * sampleRate)
+                break;
+
+            auto lowBin = std::clamp((int)std::floor(frequency / halfBandwidth / binWidth), 1, lastBin);
+            auto highBin = std::clamp((int)std::ceil(frequency * halfBandwidth / binWidth), lowBin, lastBin);
+
+            double sum = 0.0;
+            auto silent = false;
+
+            for (int bin = lowBin; bin <= highBin && ! silent; ++bin)
+            {
+                silent = power[(size_t)bin] <= 1.0e-20;
+                sum += silent ? 0.0 : 10.0 * std::log10(power[(size_t)bin]);
+            }
+
+            if (! silent)
+                decibels[(size_t)i] = sum / (highBin - lowBin + 1);
+        }
+
+        return decibels;
+    }
+
+    /*What the EQ has to add to the target to sound like the reference, on the grid.*/
+    static std::vector<FitPoint> makePoints(const std::vector<double>& referenceDecibels,
+                                            const std::vector<double>& targetDecibels)
+    {
+        std::vector<FitPoint> points;
+
+        for (int i = 0; i < numGridPoints; ++i)
+        {
+            //Bins above either file's Nyquist, or silent in either file, tell us nothing
+            if (std::isnan(referenceDecibels[(size_t)i]) || std::isnan(targetDecibels[(size_t)i]))
+                continue;
+
+            points.push_back({ getGridFrequency(i), referenceDecibels[(size_t)i] - targetDecibels[(size_t)i] });
+        }
+
+        return points;
+    }
+
+    /*
+    Starting point for the solver. The cuts start where the difference first falls
+    3 dB below its median level (a Butterworth's -3 dB point), and the peak starts
+    on the largest remaining deviation between them.
+    */
+    static void initialGuess(const std::vector<FitPoint>& points, double* p)
+    {
+        std::vector<double> sorted;
+
+        for (auto& point : points)
+            sorted.push_back(point.differenceInDecibels);
+
+        std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t)(sorted.size() / 2), sorted.end());
+        auto level = sorted[sorted.size() / 2];
+
+        auto numPoints = (int)points.size();
+        auto lowIndex = 0, highIndex = numPoints - 1;
+
+        while (lowIndex < highIndex && points[(size_t)lowIndex].differenceInDecibels < level - 3.0)
+            ++lowIndex;
+
+        while (highIndex > lowIndex && points[(size_t)highIndex].differenceInDecibels < level - 3.0)
+            --highIndex;
+
+        p[Fit_LogLowCutFreq] = lowIndex > 0 ? std::log(points[(size_t)lowIndex].frequency) : std::log(20.0);
+        p[Fit_LogHighCutFreq] = highIndex < numPoints - 1 ? std::log(points[(size_t)highIndex].frequency) : std::log(20000.0);
+
+        //Stay about half an octave clear of the cuts so the peak doesn't chase their roll-off
+        const auto margin = 5;
+        auto peakIndex = (lowIndex + highIndex) / 2;
+
+        for (int i = lowIndex + margin; i <= highIndex - margin; ++i)
+            if (std::abs(points[(size_t)i].differenceInDecibels - level)
+                > std::abs(points[(size_t)peakIndex].differenceInDecibels - level))
+                peakIndex = i;
+
+        p[Fit_LogPeakFreq] = std::log(points[(size_t)peakIndex].frequency);
+        p[Fit_PeakGain] = points[(size_t)peakIndex].differenceInDecibels - level;
+        p[Fit_LogPeakQ] = 0.0;
+        p[Fit_Offset] = level;
+
+        clampToParameterRanges(p);
+    }
+
+    /*Levenberg-Marquardt with a forward-difference Jacobian. Returns the final cost.*/
+    static double fitBands(double* p, int lowCutSlope, int highCutSlope,
+                           const std::vector<FitPoint>& points, double sampleRate)
+    {
+        const int n = Fit_NumParameters;
+        const double step = 1.0e-4;
+
+        auto cost = fitCost(p, lowCutSlope, highCutSlope, points, sampleRate);
+        auto lambda = 1.0e-3;
+
+        for (int iteration = 0; iteration < 50; ++iteration)
+        {
+            double jtj[Fit_NumParameters][Fit_NumParameters] = {};
+            double jtr[Fit_NumParameters] = {};
+
+            for (auto& point : points)
+            {
+                auto model = modelDecibels(p, lowCutSlope, highCutSlope, point.frequency, sampleRate);
+                double jacobian[Fit_NumParameters];
+
+                for (int i = 0; i < n; ++i)
+                {
+                    double shifted[Fit_NumParameters];
+                    std::copy(p, p + n, shifted);
+                    shifted[i] += step;
+
+                    jacobian[i] = (modelDecibels(shifted, lowCutSlope, highCutSlope, point.frequency, sampleRate) - model) / step;
+                }
+
+                auto residual = model - point.differenceInDecibels;
+
+                for (int i = 0; i < n; ++i)
+                {
+                    jtr[i] += jacobian[i] * residual;
+
+                    for (int k = 0; k < n; ++k)
+                        jtj[i][k] += jacobian[i] * jacobian[k];
+                }
+            }
+
+            //Raise lambda until a step actually improves the fit
+            auto improved = false;
+
+            while (! improved && lambda < 1.0e7)
+            {
+                double damped[Fit_NumParameters][Fit_NumParameters];
+                double delta[Fit_NumParameters];
+
+                for (int i = 0; i < n; ++i)
+                {
+                    std::copy(jtj[i], jtj[i] + n, damped[i]);
+                    damped[i][i] += lambda * jtj[i][i] + 1.0e-9;
+                    delta[i] = -jtr[i];
+                }
+
+                if (solve(damped, delta))
+                {
+                    double candidate[Fit_NumParameters];
+
+                    for (int i = 0; i < n; ++i)
+                        candidate[i] = p[i] + delta[i];
+
+                    clampToParameterRanges(candidate);
+                    auto candidateCost = fitCost(candidate, lowCutSlope, highCutSlope, points, sampleRate);
+
+                    if (candidateCost < cost)
+                    {
+                        auto converged = cost - candidateCost < 1.0e-9 * cost;
+
+                        std::copy(candidate, candidate + n, p);
+                        cost = candidateCost;
+                        lambda = std::max(1.0e-7, lambda / 3.0);
+                        improved = true;
+
+                        if (converged)
+                            return cost;
+
+                        continue;
+                    }
+                }
+
+                lambda *= 4.0;
+            }
+
+            if (! improved)
+                break;
+        }
+
+        return cost;
+    }
+
+private:
+    static double warp(double frequency, double sampleRate)
+    {
+        const auto pi = 3.141592653589793238;
+        return std::tan(pi * std::min(frequency, 0.499 * sampleRate) / sampleRate);
+    }
+
+    static double modelDecibels(const double* p, int lowCutSlope, int highCutSlope,
+                                double frequency, double sampleRate)
+    {
+        auto w = warp(frequency, sampleRate);
+
+        //|H|^2 = 1 / (1 + ratio^2N) for an order N Butterworth, with N = (slope + 1) * 2
+        auto lowCutExponent = 2.0 * (lowCutSlope + 1) * 2;
+        auto highCutExponent = 2.0 * (highCutSlope + 1) * 2;
+
+        auto lowCut = -10.0 * std::log10(1.0 + std::pow(warp(std::exp(p[Fit_LogLowCutFreq]), sampleRate) / w, lowCutExponent));
+        auto highCut = -10.0 * std::log10(1.0 + std::pow(w / warp(std::exp(p[Fit_LogHighCutFreq]), sampleRate), highCutExponent));
+
+        auto omega = w / warp(std::exp(p[Fit_LogPeakFreq]), sampleRate);
+        auto A = std::pow(10.0, p[Fit_PeakGain] / 40.0);
+        auto Q = std::exp(p[Fit_LogPeakQ]);
+        auto real = (1.0 - omega * omega) * (1.0 - omega * omega);
+        auto boost = omega * A / Q, cut = omega / (A * Q);
+        auto peak = 10.0 * std::log10((real + boost * boost) / (real + cut * cut));
+
+        return p[Fit_Offset] + lowCut + highCut + peak;
+    }
+
+    /*Keeps the solver inside the ranges createParameterLayout() allows.*/
+    static void clampToParameterRanges(double* p)
+    {
+        const auto logMinFreq = std::log(20.0), logMaxFreq = std::log(20000.0);
+
+        p[Fit_LogLowCutFreq] = std::clamp(p[Fit_LogLowCutFreq], logMinFreq, logMaxFreq);
+        p[Fit_LogHighCutFreq] = std::clamp(p[Fit_LogHighCutFreq], logMinFreq, logMaxFreq);
+        p[Fit_LogPeakFreq] = std::clamp(p[Fit_LogPeakFreq], logMinFreq, logMaxFreq);
+        p[Fit_PeakGain] = std::clamp(p[Fit_PeakGain], -24.0, 24.0);
+        p[Fit_LogPeakQ] = std::clamp(p[Fit_LogPeakQ], std::log(0.1), std::log(10.0));
+    }
+
+    static double fitCost(const double* p, int lowCutSlope, int highCutSlope,
+                          const std::vector<FitPoint>& points, double sampleRate)
+    {
+        double cost = 0.0;
+
+        for (auto& point : points)
+        {
+            auto error = modelDecibels(p, lowCutSlope, highCutSlope, point.frequency, sampleRate)
+                - point.differenceInDecibels;
+            cost += error * error;
+        }
+
+        return cost;
+    }
+
+    /*Gaussian elimination with partial pivoting; the system is only Fit_NumParameters wide.*/
+    static bool solve(double (&m)[Fit_NumParameters][Fit_NumParameters], double (&b)[Fit_NumParameters])
+    {
+        const int n = Fit_NumParameters;
+
+        for (int col = 0; col < n; ++col)
+        {
+            auto pivot = col;
+
+            for (int row = col + 1; row < n; ++row)
+                if (std::abs(m[row][col]) > std::abs(m[pivot][col]))
+                    pivot = row;
+
+            if (std::abs(m[pivot][col]) < 1.0e-12)
+                return false;
+
+            std::swap(m[pivot], m[col]);
+            std::swap(b[pivot], b[col]);
+
+            for (int row = col + 1; row < n; ++row)
+            {
+                auto factor = m[row][col] / m[col][col];
+
+                for (int k = col; k < n; ++k)
+                    m[row][k] -= factor * m[col][k];
+
+                b[row] -= factor * b[col];
+            }
+        }
+
+        for (int row = n - 1; row >= 0; --row)
+        {
+            for (int k = row + 1; k < n; ++k)
+                b[row] -= m[row][k] * b[k];
+
+            b[row] /= m[row][row];
+        }
+
+        return true;
+    }
+};
@@ -10,16 +10,28 @@
 #include "PluginEditor.h"
 
 int plugin_width = 200,
-plugin_height = 200;
+plugin_height = 200,
+match_eq_row_height = 30;
 
 
 //==============================================================================
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
+    addAndMakeVisible(genericEditor);
+
+    matchEQButton.onClick = [this] { chooseMatchEQFiles(); };
+    addAndMakeVisible(matchEQButton);
+
+    //An analysis can outlive the editor that started it
+    matchEQButton.setEnabled(! audioProcessor.isMatchEQRunning());
+    matchEQStatus.setText(audioProcessor.isMatchEQRunning() ? "Analysing..." : "", juce::dontSendNotification);
+    addAndMakeVisible(matchEQStatus);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (plugin_width, plugin_height);
+    setSize (juce::jmax(plugin_width, genericEditor.getWidth()),
+             juce::jmax(plugin_height, genericEditor.getHeight() + match_eq_row_height));
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
@@ -31,14 +43,62 @@ void SimpleEQAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void SimpleEQAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto bounds = getLocalBounds();
+    auto matchEQRow = bounds.removeFromBottom(match_eq_row_height).reduced(4);
+
+    matchEQButton.setBounds(matchEQRow.removeFromLeft(100));
+    matchEQStatus.setBounds(matchEQRow.withTrimmedLeft(4));
+    genericEditor.setBounds(bounds);
+}
+
+void SimpleEQAudioProcessorEditor::chooseMatchEQFiles()
+{
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    const juce::String audioFiles = "*.wav;*.aif;*.aiff;*.flac;*.ogg";
+
+    //Each chooser is a member, so closing the editor cancels it rather than calling back into a dead editor
+    referenceChooser = std::make_unique<juce::FileChooser>("Choose the reference (the sound to match)",
+                                                           juce::File(), audioFiles);
+
+    referenceChooser->launchAsync(flags, [this, flags, audioFiles](const juce::FileChooser& chooser)
+    {
+        auto referenceFile = chooser.getResult();
+
+        if (referenceFile == juce::File())
+            return;
+
+        targetChooser = std::make_unique<juce::FileChooser>("Choose the target (the sound this EQ is on)",
+                                                            referenceFile.getParentDirectory(), audioFiles);
+
+        targetChooser->launchAsync(flags, [this, referenceFile](const juce::FileChooser& targetChooserResult)
+        {
+            auto targetFile = targetChooserResult.getResult();
+
+            if (targetFile != juce::File())
+                startMatchEQ(referenceFile, targetFile);
+        });
+    });
+}
+
+void SimpleEQAudioProcessorEditor::startMatchEQ(const juce::File& referenceFile, const juce::File& targetFile)
+{
+    matchEQButton.setEnabled(false);
+    matchEQStatus.setText("Analysing...", juce::dontSendNotification);
+
+    //The editor may be closed before the analysis finishes
+    juce::Component::SafePointer<SimpleEQAudioProcessorEditor> safeThis(this);
+
+    audioProcessor.startMatchEQ(referenceFile, targetFile, [safeThis](const juce::Result& result)
+    {
+        if (safeThis == nullptr)
+            return;
+
+        safeThis->matchEQButton.setEnabled(! safeThis->audioProcessor.isMatchEQRunning());
+        safeThis->matchEQStatus.setText(result.wasOk() ? "Matched" : result.getErrorMessage(),
+                                        juce::dontSendNotification);
+    });
 }
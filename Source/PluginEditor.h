@@ -29,5 +29,19 @@ private:
     // access the processor object that created it.
     SimpleEQAudioProcessor& audioProcessor;
 
+    //Knobs for every parameter until the EQ gets its own GUI
+    juce::GenericAudioProcessorEditor genericEditor{ audioProcessor };
+
+    /*
+    Match EQ: pick the reference (the sound to match), then the target (the
+    sound this EQ is on). The status line shows the outcome.
+    */
+    juce::TextButton matchEQButton{ "Match EQ..." };
+    juce::Label matchEQStatus;
+    std::unique_ptr<juce::FileChooser> referenceChooser, targetChooser;
+
+    void chooseMatchEQFiles();
+    void startMatchEQ(const juce::File& referenceFile, const juce::File& targetFile);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessorEditor)
 };
@@ -11,6 +11,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "MatchEQ.h"
 #include <iostream>
 
 /*
@@ -58,6 +59,15 @@ low_cut_slope_parameter_name = low_cut_slope_string;
 auto high_cut_slope_parameter_ID = high_cut_slope_string,
 high_cut_slope_parameter_name = high_cut_slope_string;
 
+auto parallel_channels_parameter_ID = parallel_channels_string,
+parallel_channels_parameter_name = parallel_channels_string;
+
+auto saturation_mode_parameter_ID = saturation_mode_string,
+saturation_mode_parameter_name = saturation_mode_string;
+
+auto drive_parameter_ID = drive_string,
+drive_parameter_name = drive_string;
+
 
 //==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
@@ -72,10 +82,15 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                        )
 #endif
 {
+    apvts.addParameterListener(parallel_channels_parameter_ID, this);
+    apvts.addParameterListener(saturation_mode_parameter_ID, this);
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    apvts.removeParameterListener(parallel_channels_parameter_ID, this);
+    apvts.removeParameterListener(saturation_mode_parameter_ID, this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -152,12 +167,36 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
 
-    //prepare each chain (Left and Right)
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    //prepare one chain per channel
+    auto numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    chains.clear();
+
+    for (int i = 0; i < numChannels; ++i)
+        chains.add(new MonoChain())->prepare(spec);
+
+    /*
+    Block size or sample rate may have changed, so stop the workers here. The host
+    may call this from any thread, so they only restart from the message thread;
+    until then run() processes every group on the audio thread.
+    */
+    preparedNumChannels = numChannels;
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+    workers.release();
+    triggerAsyncUpdate();
+
+    saturator.prepare(sampleRate, samplesPerBlock, numChannels);
+
+    //Freshly prepared chains have nothing to crossfade from
+    auto chainSettings = getChainSettings(apvts);
+    lowCutSlope = chainSettings.lowCutSlope;
+    highCutSlope = chainSettings.highCutSlope;
 
     //do processing for one buffer. Is this necessary?
     updateFilters();
+    updateSaturator(0);
+    updateLatency();
 
 }
 
@@ -165,6 +204,8 @@ void SimpleEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    preparedNumChannels = 0;
+    workers.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -174,12 +215,12 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel gets its own mono chain, so any layout works
+    // (mono, stereo, surround, ambisonic or discrete object buses)
+    // as long as it fits in maxNumChannels.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numChannels == 0 || numChannels > maxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -195,6 +236,10 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    //Workers must be done by the time this block is due
+    auto deadlineMs = juce::Time::getMillisecondCounterHiRes()
+        + 1000.0 * buffer.getNumSamples() / getSampleRate();
+
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -212,23 +257,92 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
 
     /*...Easy to do, as the function below does all audio processing*/
     updateFilters();
+    updateSaturator(buffer.getNumSamples());
 
     juce::dsp::AudioBlock<float> block(buffer);
-    
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
 
+    auto numChannels = juce::jmin((int)block.getNumChannels(), totalNumInputChannels, chains.size());
+    auto parallel = apvts.getRawParameterValue(parallel_channels_parameter_ID)->load() > 0.5f;
+
+    if (! parallel || numChannels < minChannelsForParallel)
+    {
+        processChannels(block, 0, numChannels);
+        return;
+    }
+
+    //Groups never share a channel, so the workers never touch the same chain
+    channelGroupJob.block = block.getSubsetChannelBlock(0, (size_t)numChannels);
+    workers.run(channelGroupJob, (numChannels + channelsPerGroup - 1) / channelsPerGroup, deadlineMs);
+
+}
+
+void SimpleEQAudioProcessor::processChannels(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept
+{
     //Now we can create processing contexts that wrap each individual audio block
     using J_process_context = juce::dsp::ProcessContextReplacing<float>;
-    J_process_context leftContext(leftBlock),
-                      rightContext(rightBlock);
 
-    //Pass contexts to mono filter chains
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    for (int channel = firstChannel; channel < firstChannel + numChannels; ++channel)
+    {
+        auto channelBlock = block.getSingleChannelBlock((size_t)channel);
+        J_process_context context(channelBlock);
+
+        //Pass context to this channel's mono filter chain
+        chains.getUnchecked(channel)->process(context);
+    }
+
+    //The saturator works across the whole group at once
+    saturator.process(block, firstChannel, numChannels);
+}
+
+void SimpleEQAudioProcessor::ChannelGroupJob::processGroup(int groupIndex) noexcept
+{
+    auto firstChannel = groupIndex * channelsPerGroup;
+    auto numChannels = juce::jmin(channelsPerGroup, (int)block.getNumChannels() - firstChannel);
+
+    owner.processChannels(block, firstChannel, numChannels);
+}
+
+void SimpleEQAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(parameterID, newValue);
+    triggerAsyncUpdate();
+}
 
+void SimpleEQAudioProcessor::handleAsyncUpdate()
+{
+    updateWorkers();
+    updateLatency();
 }
 
+/*
+Message thread only. Starts or stops worker threads to match "Parallel Channels".
+Reads the prepared layout from atomics rather than chains, which prepareToPlay
+may be rebuilding on another thread.
+*/
+void SimpleEQAudioProcessor::updateWorkers()
+{
+    auto parallel = apvts.getRawParameterValue(parallel_channels_parameter_ID)->load() > 0.5f;
+    auto numChannels = preparedNumChannels.load();
+    auto numWorkers = 0;
+
+    //Only spin up workers when the option is on and the bus is big enough to use them
+    if (parallel && numChannels >= minChannelsForParallel)
+    {
+        auto numGroups = (numChannels + channelsPerGroup - 1) / channelsPerGroup;
+        numWorkers = juce::jmax(0, juce::jmin(maxNumWorkers, numGroups - 1, juce::SystemStats::getNumCpus() - 1));
+    }
+
+    workers.prepare(numWorkers, preparedSampleRate.load(), preparedBlockSize.load());
+}
+
+#if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+void SimpleEQAudioProcessor::audioWorkgroupContextChanged(const juce::AudioWorkgroup& workgroup)
+{
+    //Workers join the host's audio workgroup so the OS schedules them alongside the audio thread
+    workers.setWorkgroup(workgroup);
+}
+#endif
+
 //==============================================================================
 bool SimpleEQAudioProcessor::hasEditor() const
 {
@@ -237,8 +351,7 @@ bool SimpleEQAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* SimpleEQAudioProcessor::createEditor()
 {
-    //retugetChainSettingsrn new SimpleEQAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new SimpleEQAudioProcessorEditor (*this);
 }
 
 //==============================================================================
@@ -255,6 +368,33 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     // whose contents will have been created by the getStateInformation() call.
 }
 
+void SimpleEQAudioProcessor::startMatchEQ(const juce::File& referenceFile, const juce::File& targetFile,
+                                          std::function<void(const juce::Result&)> onComplete)
+{
+    if (matchEQAnalyzer != nullptr)
+    {
+        if (onComplete != nullptr)
+            onComplete(juce::Result::fail("A Match EQ analysis is already running"));
+
+        return;
+    }
+
+    //Only exists while analysing, so its pool threads don't idle for the plugin's lifetime
+    matchEQAnalyzer = std::make_unique<MatchEQAnalyzer>();
+
+    matchEQAnalyzer->start(referenceFile, targetFile, getSampleRate(),
+        [this, onComplete](const juce::Result& result, const ChainSettings& settings)
+        {
+            matchEQAnalyzer.reset();
+
+            if (result.wasOk())
+                setChainSettings(apvts, settings);
+
+            if (onComplete != nullptr)
+                onComplete(result);
+        });
+}
+
 /*
 This function adds a generic float knob to the GUI.
 */
@@ -283,45 +423,102 @@ void SimpleEQAudioProcessor::updateCoefficients(Coefficients& old, const Coeffic
 
 void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
 {
+    if (chains.isEmpty())
+        return;
+
+    /*
+    A new slope changes which stages run, so fade to it instead of switching
+    abruptly. Every chain transitions in lockstep, so the first one speaks for
+    all. Mid-fade we keep the old slope; the next block picks up the new one.
+    */
+    auto& firstLowCut = chains.getFirst()->get<ChainPositions::LowCut>();
+    auto beginTransition = chainSettings.lowCutSlope != lowCutSlope && firstLowCut.canBeginTransition();
+
+    if (beginTransition)
+    {
+        //A restarted prewarm still fades out of the cascade that is audible now
+        if (! firstLowCut.isTransitioning())
+            outgoingLowCutSlope = lowCutSlope;
+
+        lowCutSlope = chainSettings.lowCutSlope;
+    }
+
+    auto order = (lowCutSlope + 1) * 2;
+
     auto lowCutCoefficients =
         juce::dsp::FilterDesign<float>
         ::designIIRHighpassHighOrderButterworthMethod
-        (chainSettings.lowCutFreq, getSampleRate(),
-            (chainSettings.lowCutSlope + 1) * 2);
+        (chainSettings.lowCutFreq, getSampleRate(), order);
 
-    auto& leftLowCut = leftChain.get
-        <ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get
-        <ChainPositions::LowCut>();
+    for (auto* chain : chains)
+    {
+        auto& lowCut = chain->get<ChainPositions::LowCut>();
 
-    updateCutFilter(leftLowCut,
-        lowCutCoefficients,
-        chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut,
-        lowCutCoefficients,
-        chainSettings.lowCutSlope);
+        updateCutFilter(beginTransition ? lowCut.beginTransition(chainSettings.lowCutFreq, order) : lowCut.getTarget(),
+            lowCutCoefficients,
+            lowCutSlope);
+    }
+
+    //The outgoing cascade is still audible, so it has to follow the cutoff too
+    if (firstLowCut.isTransitioning())
+    {
+        auto outgoingCoefficients =
+            juce::dsp::FilterDesign<float>
+            ::designIIRHighpassHighOrderButterworthMethod
+            (chainSettings.lowCutFreq, getSampleRate(), (outgoingLowCutSlope + 1) * 2);
+
+        for (auto* chain : chains)
+            updateCutFilter(chain->get<ChainPositions::LowCut>().getActive(),
+                outgoingCoefficients,
+                outgoingLowCutSlope);
+    }
 
 }
 
 void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
 {
+    if (chains.isEmpty())
+        return;
+
+    auto& firstHighCut = chains.getFirst()->get<ChainPositions::HighCut>();
+    auto beginTransition = chainSettings.highCutSlope != highCutSlope && firstHighCut.canBeginTransition();
+
+    if (beginTransition)
+    {
+        if (! firstHighCut.isTransitioning())
+            outgoingHighCutSlope = highCutSlope;
+
+        highCutSlope = chainSettings.highCutSlope;
+    }
+
+    auto order = (highCutSlope + 1) * 2;
+
     auto highCutCoefficients =
         juce::dsp::FilterDesign<float>
         ::designIIRLowpassHighOrderButterworthMethod
-        (chainSettings.highCutFreq, getSampleRate(),
-            (chainSettings.highCutSlope + 1) * 2);
+        (chainSettings.highCutFreq, getSampleRate(), order);
 
-    auto& leftHighCut = leftChain.get
-        <ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get
-        <ChainPositions::HighCut>();
+    for (auto* chain : chains)
+    {
+        auto& highCut = chain->get<ChainPositions::HighCut>();
 
-    updateCutFilter(leftHighCut,
-        highCutCoefficients,
-        chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut,
-        highCutCoefficients,
-        chainSettings.highCutSlope);
+        updateCutFilter(beginTransition ? highCut.beginTransition(chainSettings.highCutFreq, order) : highCut.getTarget(),
+            highCutCoefficients,
+            highCutSlope);
+    }
+
+    if (firstHighCut.isTransitioning())
+    {
+        auto outgoingCoefficients =
+            juce::dsp::FilterDesign<float>
+            ::designIIRLowpassHighOrderButterworthMethod
+            (chainSettings.highCutFreq, getSampleRate(), (outgoingHighCutSlope + 1) * 2);
+
+        for (auto* chain : chains)
+            updateCutFilter(chain->get<ChainPositions::HighCut>().getActive(),
+                outgoingCoefficients,
+                outgoingHighCutSlope);
+    }
 
 }
 
@@ -333,6 +530,29 @@ void SimpleEQAudioProcessor::updateFilters()
     updateHighCutFilters(chainSettings);
 }
 
+void SimpleEQAudioProcessor::updateSaturator(int numSamples)
+{
+    auto mode = static_cast<SaturationMode>(apvts.getRawParameterValue(saturation_mode_parameter_ID)->load());
+    auto driveInDecibels = apvts.getRawParameterValue(drive_parameter_ID)->load();
+
+    saturator.setParameters(mode, driveInDecibels, numSamples);
+}
+
+/*
+Called from prepareToPlay and the message thread. Only the oversampled
+reference has latency; ADAA runs at 1x with none. The mode isn't automatable,
+so this only moves when the user picks a different mode, never in the middle
+of automated playback.
+*/
+void SimpleEQAudioProcessor::updateLatency()
+{
+    auto mode = static_cast<SaturationMode>(apvts.getRawParameterValue(saturation_mode_parameter_ID)->load());
+    auto latency = saturator.getLatencyInSamples(mode);
+
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
 void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
 {
 
@@ -347,12 +567,10 @@ void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings
         getSampleRate(), chainSettings.peakFreq, chainSettings.peakQuality,
         dB::decibelsToGain(chainSettings.peakGainInDecibels));
 
-    updateCoefficients(
-        leftChain.get<ChainPositions::Peak>().coefficients,
-        peakCoefficients);
-    updateCoefficients(
-        rightChain.get<ChainPositions::Peak>().coefficients,
-        peakCoefficients);
+    for (auto* chain : chains)
+        updateCoefficients(
+            chain->get<ChainPositions::Peak>().coefficients,
+            peakCoefficients);
 
 }
 
@@ -428,6 +646,24 @@ APVTS::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
     layout.add(std::make_unique<J_choice>
         (high_cut_slope_parameter_ID, high_cut_slope_parameter_name, HP_LP_slope_string, default_slope));
 
+    //Saturation after the EQ
+    J_StringArray saturation_mode_string_array{ "Off", "ADAA 1st Order", "ADAA 2nd Order", "Oversampled 4x" };
+
+    layout.add(std::make_unique<J_choice>
+        (saturation_mode_parameter_ID, saturation_mode_parameter_name, saturation_mode_string_array, Saturation_Off,
+            juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
+    add_knob(drive_parameter_ID, drive_parameter_name,
+        0.f, 0.f,
+        24.f, 0.05f,
+        1.f, layout);
+
+    //Splits large buses across worker threads; ignored for small channel counts.
+    //A threading setting rather than part of the sound, so hosts can't automate it
+    layout.add(std::make_unique<juce::AudioParameterBool>
+        (parallel_channels_parameter_ID, parallel_channels_parameter_name, false,
+            juce::AudioParameterBoolAttributes().withAutomatable(false)));
+
 
     return layout;
 }
@@ -461,6 +697,29 @@ ChainSettings getChainSettings(APVTS& apvts)
     return settings;
 }
 
+/*
+The reverse of getChainSettings(): pushes settings to the host as parameter changes,
+each as its own gesture so hosts record them like a user edit. Message thread only.
+*/
+void setChainSettings(APVTS& apvts, const ChainSettings& settings)
+{
+    auto set = [&apvts](const char* parameter_ID, float value)
+    {
+        auto* parameter = apvts.getParameter(parameter_ID);
+        parameter->beginChangeGesture();
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        parameter->endChangeGesture();
+    };
+
+    set(low_cut_freq_parameter_ID, settings.lowCutFreq);
+    set(high_cut_freq_parameter_ID, settings.highCutFreq);
+    set(PK_freq_parameter_ID, settings.peakFreq);
+    set(PK_gain_parameter_ID, settings.peakGainInDecibels);
+    set(PK_Q_parameter_ID, settings.peakQuality);
+    set(low_cut_slope_parameter_ID, (float)settings.lowCutSlope);
+    set(high_cut_slope_parameter_ID, (float)settings.highCutSlope);
+}
+
 
 //==============================================================================
 // This creates new instances of the plugin..
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ChannelGroupWorkers.h"
+#include "Saturation.h"
+#include "CrossfadingCutFilter.h"
 
 #define low_cut_freq_string "LowCut Freq"
 #define low_cut_slope_string "LowCut Slope"
@@ -26,6 +29,11 @@
 #define N_PK_freq_default_value 750.f
 #define N_PK_freq_SkewFactor 1.f
 
+#define parallel_channels_string "Parallel Channels"
+
+#define saturation_mode_string "Saturation"
+#define drive_string "Drive"
+
 using APVTS = juce::AudioProcessorValueTreeState;
 
 enum Slope
@@ -48,6 +56,9 @@ struct ChainSettings
 };
 
 ChainSettings getChainSettings(APVTS& apvts);
+void setChainSettings(APVTS& apvts, const ChainSettings& settings);
+
+class MatchEQAnalyzer;
 
 //==============================================================================
 /**
@@ -56,6 +67,8 @@ class SimpleEQAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private APVTS::Listener
+                             , private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -72,6 +85,10 @@ public:
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+   #if SIMPLEEQ_HAS_AUDIO_WORKGROUPS
+    void audioWorkgroupContextChanged (const juce::AudioWorkgroup&) override;
+   #endif
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -100,12 +117,69 @@ public:
     //juce::UndoManager undo_manager = juce::UndoManager(30000,30);
     APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
+    /*
+    Analyses both files in the background and, when done, sets the bands so the
+    target's tonal balance matches the reference. Call from the message thread.
+    onComplete gets the outcome on the message thread: an error if the files
+    couldn't be analysed, or straight away if an analysis is already running.
+    */
+    void startMatchEQ(const juce::File& referenceFile, const juce::File& targetFile,
+                      std::function<void(const juce::Result&)> onComplete);
+
+    //True from startMatchEQ() until its onComplete has run. Message thread only
+    bool isMatchEQRunning() const { return matchEQAnalyzer != nullptr; }
+
 private:
     using Filter = juce::dsp::IIR::Filter<float>;
     using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-    using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+    using MonoChain = juce::dsp::ProcessorChain<CrossfadingCutFilter<CutFilter>, Filter, CrossfadingCutFilter<CutFilter>>;
     
-    MonoChain leftChain, rightChain;
+    //One mono chain per channel; the channels never interact
+    juce::OwnedArray<MonoChain> chains;
+
+    /*
+    Large buses (ambisonics, object beds) are split into groups of channels
+    that the worker pool can process in parallel. Below the threshold the
+    fork/join costs more than it saves, so we stay serial.
+    */
+    static constexpr int maxNumChannels = 64;
+    static constexpr int channelsPerGroup = 8;
+    static_assert(channelsPerGroup % TubeSaturator::lanesPerGroup == 0,
+        "A channel group must never split a set of saturator lanes");
+    static constexpr int minChannelsForParallel = 2 * channelsPerGroup;
+    static constexpr int maxNumWorkers = 3;
+
+    struct ChannelGroupJob : ChannelGroupWorkers::Job
+    {
+        ChannelGroupJob(SimpleEQAudioProcessor& o) : owner(o) {}
+        void processGroup(int groupIndex) noexcept override;
+
+        SimpleEQAudioProcessor& owner;
+        juce::dsp::AudioBlock<float> block;
+    };
+
+    ChannelGroupWorkers workers;
+    ChannelGroupJob channelGroupJob{ *this };
+
+    /*
+    Threads are only started while "Parallel Channels" is on, and latency only
+    changes with "Saturation". Either can change on any thread, so both are
+    applied from the message thread.
+    */
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void updateWorkers();
+
+    //Written by prepareToPlay and releaseResources, read by updateWorkers on the message thread
+    std::atomic<int> preparedNumChannels{ 0 }, preparedBlockSize{ 0 };
+    std::atomic<double> preparedSampleRate{ 0.0 };
+
+    void processChannels(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept;
+
+    //Runs after the EQ on every channel
+    TubeSaturator saturator;
+    void updateSaturator(int numSamples);
+    void updateLatency();
     
     enum ChainPositions
     {
@@ -186,7 +260,15 @@ private:
     void updateLowCutFilters(const ChainSettings& chainSettings);
     void updateHighCutFilters(const ChainSettings& chainsettings);
 
+    //Slopes the cut filters run (or are fading to). A change waits here until the previous fade ends
+    Slope lowCutSlope{ Slope_12 }, highCutSlope{ Slope_12 };
+
+    //Slopes of the cascades being faded out, which keep following the cutoff until the fade ends
+    Slope outgoingLowCutSlope{ Slope_12 }, outgoingHighCutSlope{ Slope_12 };
+
     void updateFilters();
+
+    std::unique_ptr<MatchEQAnalyzer> matchEQAnalyzer;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessor)
 };
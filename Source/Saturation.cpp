@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    Saturation.cpp
+
+  ==============================================================================
+*/
+
+#include "Saturation.h"
+
+/*
+The reference path runs at 2^2 = 4x. Integer latency keeps the value we
+report to the host exact.
+*/
+static constexpr size_t oversamplingFactorLog2 = 2;
+
+/*Long enough that automating Drive doesn't zipper, short enough to feel immediate.*/
+static constexpr double driveRampSeconds = 0.05;
+
+TubeSaturator::TubeSaturator()
+{
+}
+
+TubeSaturator::~TubeSaturator()
+{
+}
+
+void TubeSaturator::prepare(double sampleRate, int maximumBlockSize, int numChannels)
+{
+    smoothedDrive.reset(sampleRate, driveRampSeconds);
+
+    laneGroups.resize((size_t)((numChannels + lanesPerGroup - 1) / lanesPerGroup));
+
+    //One mono oversampler per channel, so channel groups can run on any thread
+    oversamplers.clear();
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        auto* oversampler = oversamplers.add(new juce::dsp::Oversampling<float>(
+            1, oversamplingFactorLog2,
+            juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+            true, true));
+
+        oversampler->initProcessing((size_t)maximumBlockSize);
+    }
+
+    oversampledLatency = oversamplers.isEmpty() ? 0 : juce::roundToInt(oversamplers.getFirst()->getLatencyInSamples());
+
+    reset();
+}
+
+void TubeSaturator::reset() noexcept
+{
+    for (auto& lanes : laneGroups)
+        lanes.reset();
+
+    for (auto* oversampler : oversamplers)
+        oversampler->reset();
+
+    //Nothing to ramp from after a reset
+    jumpToTargetDrive = true;
+}
+
+void TubeSaturator::setParameters(SaturationMode newMode, float driveInDecibels, int numSamples) noexcept
+{
+    if (newMode != mode)
+    {
+        mode = newMode;
+        reset();
+    }
+
+    auto targetDrive = (double)juce::Decibels::decibelsToGain(driveInDecibels);
+
+    if (jumpToTargetDrive)
+        smoothedDrive.setCurrentAndTargetValue(targetDrive);
+    else
+        smoothedDrive.setTargetValue(targetDrive);
+
+    jumpToTargetDrive = false;
+
+    blockStartDrive = smoothedDrive.getCurrentValue();
+    blockEndDrive = smoothedDrive.skip(numSamples);
+}
+
+int TubeSaturator::getLatencyInSamples(SaturationMode modeToQuery) const noexcept
+{
+    return modeToQuery == Saturation_Oversampled ? oversampledLatency.load() : 0;
+}
+
+void TubeSaturator::process(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept
+{
+    if (mode == Saturation_Off || numChannels <= 0)
+        return;
+
+    if (mode == Saturation_Oversampled)
+    {
+        processOversampled(block, firstChannel, numChannels);
+        return;
+    }
+
+    //Otherwise two concurrent ranges could share one set of lanes
+    jassert(firstChannel % lanesPerGroup == 0);
+
+    auto numSamples = (int)block.getNumSamples();
+
+    for (int first = firstChannel; first < firstChannel + numChannels; first += lanesPerGroup)
+    {
+        auto numLanes = juce::jmin(lanesPerGroup, firstChannel + numChannels - first);
+        float* channels[lanesPerGroup] = {};
+
+        for (int lane = 0; lane < numLanes; ++lane)
+            channels[lane] = block.getChannelPointer((size_t)(first + lane));
+
+        auto& lanes = laneGroups[(size_t)(first / lanesPerGroup)];
+
+        if (mode == Saturation_ADAA1)
+            lanes.process<1>(channels, numLanes, numSamples, blockStartDrive, blockEndDrive);
+        else
+            lanes.process<2>(channels, numLanes, numSamples, blockStartDrive, blockEndDrive);
+    }
+}
+
+/*
+Reference path: the plain curve at 4x. Costs the oversampling filters'
+CPU and their latency, which the processor reports from the message thread.
+*/
+void TubeSaturator::processOversampled(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept
+{
+    auto offset = SoftClipCurve::curve(SoftClipCurve::bias);
+
+    for (int channel = firstChannel; channel < firstChannel + numChannels; ++channel)
+    {
+        auto* oversampler = oversamplers.getUnchecked(channel);
+        auto channelBlock = block.getSingleChannelBlock((size_t)channel);
+
+        auto upsampled = oversampler->processSamplesUp(channelBlock);
+        auto* samples = upsampled.getChannelPointer(0);
+        auto numSamples = upsampled.getNumSamples();
+
+        //Same ramp as the ADAA path, spread over the oversampled block
+        auto driveStep = (blockEndDrive - blockStartDrive) / (double)numSamples;
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto drive = blockStartDrive + driveStep * (double)(i + 1);
+            samples[i] = (float)((SoftClipCurve::curve(drive * samples[i] + SoftClipCurve::bias) - offset) / drive);
+        }
+
+        oversampler->processSamplesDown(channelBlock);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Saturation.h
+
+    Tube-style waveshaper that sits after the EQ. The curve is an asymmetric
+    cubic soft clipper, run either at 1x with antiderivative anti-aliasing
+    (ADAA, no reported latency) or at 4x through juce::dsp::Oversampling as a
+    reference.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "ADAAKernels.h"
+
+enum SaturationMode
+{
+    Saturation_Off,
+    Saturation_ADAA1,
+    Saturation_ADAA2,
+    Saturation_Oversampled
+};
+
+class TubeSaturator
+{
+public:
+    TubeSaturator();
+    ~TubeSaturator();
+
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels);
+    void reset() noexcept;
+
+    /*
+    Call once per block from the audio thread, before process(). Drive is
+    smoothed: every channel ramps across the block from where the previous
+    block ended, so calls for different channel groups stay in step.
+    */
+    void setParameters(SaturationMode newMode, float driveInDecibels, int numSamples) noexcept;
+
+    SaturationMode getMode() const noexcept { return mode; }
+
+    /*ADAA adds a fraction of a sample of group delay but nothing worth reporting.*/
+    int getLatencyInSamples(SaturationMode modeToQuery) const noexcept;
+
+    /*
+    Processes channels [firstChannel, firstChannel + numChannels) of the block.
+    Calls on disjoint channel ranges may run concurrently, as long as each range
+    starts on a multiple of lanesPerGroup.
+    */
+    void process(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept;
+
+    /*
+    ADAA keeps state for this many channels per group and runs them through
+    ADAAVector: one AVX register, or two SSE2/NEON registers of which only the
+    ones holding live channels run.
+    */
+    static constexpr int lanesPerGroup = 4;
+
+private:
+    void processOversampled(juce::dsp::AudioBlock<float>& block, int firstChannel, int numChannels) noexcept;
+
+    SaturationMode mode = Saturation_Off;
+
+    juce::SmoothedValue<double> smoothedDrive{ 1.0 };
+    double blockStartDrive = 1.0, blockEndDrive = 1.0;
+    bool jumpToTargetDrive = true;
+
+    //One set of ADAA lanes per lanesPerGroup channels
+    std::vector<ADAALanes<lanesPerGroup>> laneGroups;
+
+    juce::OwnedArray<juce::dsp::Oversampling<float>> oversamplers;
+
+    //Set by prepare(), so the latency can be read while it rebuilds the oversamplers
+    std::atomic<int> oversampledLatency{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TubeSaturator)
+};